@@ -16,21 +16,25 @@ limitations under the License.
 
 #include "converter.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <optional>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/match.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
-#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "mapped_file.h"
 #include "minimalloc.h"
 
 namespace minimalloc {
@@ -51,6 +55,84 @@ constexpr absl::string_view kSize = "size";
 constexpr absl::string_view kStart = "start";
 constexpr absl::string_view kUpper = "upper";
 
+// The columns that are recognized when reading a CSV (others are ignored).
+enum Column {
+  kIdColumn,
+  kLowerColumn,
+  kUpperColumn,
+  kSizeColumn,
+  kAlignmentColumn,
+  kHintColumn,
+  kGapsColumn,
+  kOffsetColumn,
+  kNumColumns
+};
+
+constexpr absl::string_view kColumnNames[kNumColumns] =
+    {kId, kLower, kUpper, kSize, kAlignment, kHint, kGaps, kOffset};
+
+// Returns the text preceding the next delimiter (or all of the text, if there
+// is none), and advances the text beyond it.
+absl::string_view NextToken(absl::string_view& text, char delimiter) {
+  const size_t pos = std::min(text.find(delimiter), text.size());
+  const absl::string_view token = text.substr(0, pos);
+  text.remove_prefix(std::min(pos + 1, text.size()));
+  return token;
+}
+
+// The binary format begins with this header, followed by its columns.
+struct BinaryHeader {
+  char magic[4];
+  uint32_t version;
+  int64_t flags;
+  int64_t capacity;
+  int64_t num_buffers;
+  int64_t num_gaps;
+  int64_t num_id_bytes;
+};
+
+constexpr char kMagic[4] = {'M', 'M', 'L', 'C'};
+constexpr uint32_t kVersion = 1;
+constexpr int64_t kHasOffsets = 1 << 0;
+constexpr int64_t kHasHints = 1 << 1;
+constexpr int64_t kAbsent = std::numeric_limits<int64_t>::min();
+
+void Append(std::string& output, int64_t value) {
+  output.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Returns the next column of 'count' values and advances the input beyond it,
+// or returns nullptr if the input is too short.
+const char* TakeColumn(absl::string_view& input, int64_t count) {
+  if (count > static_cast<int64_t>(input.size() / sizeof(int64_t))) {
+    return nullptr;
+  }
+  const char* column = input.data();
+  input.remove_prefix(count * sizeof(int64_t));
+  return column;
+}
+
+int64_t Load(const char* column, int64_t idx) {
+  int64_t value;
+  std::memcpy(&value, column + idx * sizeof(int64_t), sizeof(value));
+  return value;
+}
+
+// Returns true if a begin column starts at zero, ends at 'total', and never
+// decreases in between.
+bool IsMonotonic(const char* begins, int64_t num_buffers, int64_t total) {
+  if (Load(begins, 0) != 0 || Load(begins, num_buffers) != total) return false;
+  for (int64_t buffer_idx = 0; buffer_idx < num_buffers; ++buffer_idx) {
+    if (Load(begins, buffer_idx) > Load(begins, buffer_idx + 1)) return false;
+  }
+  return true;
+}
+
+std::optional<int64_t> ToOptional(int64_t value) {
+  if (value == kAbsent) return std::nullopt;
+  return value;
+}
+
 bool IncludeAlignment(const Problem& problem) {
   for (const Buffer& buffer : problem.buffers) {
     if (buffer.alignment != 1) return true;
@@ -122,15 +204,23 @@ std::string ToCsv(const Problem& problem, Solution* solution, bool old_format) {
 absl::StatusOr<Problem> FromCsv(absl::string_view input) {
   int64_t addend = 0;
   Problem problem;
-  absl::flat_hash_map<std::string, int> col_map;
-  std::vector<absl::string_view> records = absl::StrSplit(input, '\n');
-  for (const std::string_view& record : records) {
+  // Each field is resolved once (from the header) to its recognized column (or
+  // to kNumColumns, if unrecognized).
+  std::vector<Column> field_columns;
+  bool has_column[kNumColumns] = {};
+  // Reserve space for every record up front (one per line, beyond the header).
+  const auto num_lines = std::count(input.begin(), input.end(), '\n');
+  problem.buffers.reserve(num_lines > 0 ? num_lines - 1 : 0);
+  absl::string_view fields[kNumColumns];
+  for (absl::string_view rest = input;;) {
+    const absl::string_view record = NextToken(rest, '\n');
     if (record.empty()) break;
-    std::vector<absl::string_view> fields = absl::StrSplit(record, ',');
-    if (col_map.empty()) {  // Need to read header row (to determine columns).
-      for (int field_idx = 0; field_idx < fields.size(); ++field_idx) {
+    if (field_columns.empty()) {  // Need to read header row (for columns).
+      std::vector<absl::string_view> col_names;
+      for (size_t pos = 0;;) {
+        const size_t comma = record.find(',', pos);
         // If column reads 'buffer_id', change it to 'buffer' for consistency.
-        absl::string_view col_name = fields[field_idx];
+        absl::string_view col_name = record.substr(pos, comma - pos);
         if (col_name == kBegin) col_name = kLower;
         if (col_name == kBuffer) col_name = kId;
         if (col_name == kBufferId) col_name = kId;
@@ -139,75 +229,91 @@ absl::StatusOr<Problem> FromCsv(absl::string_view input) {
           addend = 1;  // Values of an "end" column are assumed to be off-by-one
         }
         if (col_name == kStart) col_name = kLower;
-        col_map[col_name] = field_idx;
-      }
-      if (col_map.size() != fields.size()) {
-        return absl::InvalidArgumentError("Duplicate column names");
+        if (std::find(col_names.begin(), col_names.end(), col_name) !=
+            col_names.end()) {
+          return absl::InvalidArgumentError("Duplicate column names");
+        }
+        Column column = kIdColumn;
+        while (column < kNumColumns && col_name != kColumnNames[column]) {
+          column = static_cast<Column>(column + 1);
+        }
+        if (column < kNumColumns) has_column[column] = true;
+        col_names.push_back(col_name);
+        field_columns.push_back(column);
+        if (comma == absl::string_view::npos) break;
+        pos = comma + 1;
       }
-      if (!col_map.contains(kId) || !col_map.contains(kLower) ||
-          !col_map.contains(kUpper) || !col_map.contains(kSize)) {
+      if (!has_column[kIdColumn] || !has_column[kLowerColumn] ||
+          !has_column[kUpperColumn] || !has_column[kSizeColumn]) {
         return absl::NotFoundError("A required column is missing");
       }
       continue;
     }
-    if (fields.size() != col_map.size()) {
+    // Tokenize the record, keeping only the fields of recognized columns.
+    size_t field_idx = 0;
+    for (size_t pos = 0;; ++field_idx) {
+      const size_t comma = record.find(',', pos);
+      if (field_idx < field_columns.size() &&
+          field_columns[field_idx] != kNumColumns) {
+        fields[field_columns[field_idx]] = record.substr(pos, comma - pos);
+      }
+      if (comma == absl::string_view::npos) break;
+      pos = comma + 1;
+    }
+    if (field_idx + 1 != field_columns.size()) {
       return absl::InvalidArgumentError("Too many fields");
     }
-    const std::string& id = static_cast<std::string>(fields[col_map[kId]]);
     int64_t lower = -1, upper = -1, size = -1;
-    if (!absl::SimpleAtoi(fields[col_map[kLower]], &lower) ||
-        !absl::SimpleAtoi(fields[col_map[kUpper]], &upper) ||
-        !absl::SimpleAtoi(fields[col_map[kSize]], &size)) {
+    if (!absl::SimpleAtoi(fields[kLowerColumn], &lower) ||
+        !absl::SimpleAtoi(fields[kUpperColumn], &upper) ||
+        !absl::SimpleAtoi(fields[kSizeColumn], &size)) {
       return absl::InvalidArgumentError("Improperly formed integer");
     }
     int64_t alignment = 1;
-    if (col_map.contains(kAlignment)) {
-      if (!absl::SimpleAtoi(fields[col_map[kAlignment]], &alignment)) {
+    if (has_column[kAlignmentColumn]) {
+      if (!absl::SimpleAtoi(fields[kAlignmentColumn], &alignment)) {
         return absl::InvalidArgumentError(
             absl::StrCat("Improperly formed alignment: ",
-                         fields[col_map[kAlignment]]));
+                         fields[kAlignmentColumn]));
       }
     }
     std::optional<Offset> hint;
-    if (col_map.contains(kHint)) {
+    if (has_column[kHintColumn]) {
       int hint_val = -1;
-      if (!absl::SimpleAtoi(fields[col_map[kHint]], &hint_val)) {
+      if (!absl::SimpleAtoi(fields[kHintColumn], &hint_val)) {
         return absl::InvalidArgumentError("Improperly formed hint");
       }
       if (hint_val >= 0) hint = hint_val;
     }
     std::vector<Gap> gaps;
-    if (col_map.contains(kGaps)) {
-      absl::string_view gaps_str = fields[col_map[kGaps]];
-      std::vector<absl::string_view> gaps_list =
-          absl::StrSplit(gaps_str, ' ', absl::SkipEmpty());
-      for (absl::string_view gap : gaps_list) {
-        std::vector<absl::string_view> at = absl::StrSplit(gap, '@');
-        if (at.empty()) {
-          return absl::InvalidArgumentError(
-              absl::StrCat("Improperly formed gap: ", gap));
-        }
-        std::vector<absl::string_view> gap_pair = absl::StrSplit(at[0], '-');
-        if (gap_pair.size() != 2) {
+    if (has_column[kGapsColumn]) {
+      for (absl::string_view gaps_str = fields[kGapsColumn];
+           !gaps_str.empty();) {
+        const absl::string_view gap = NextToken(gaps_str, ' ');
+        if (gap.empty()) continue;
+        absl::string_view at = gap;
+        absl::string_view gap_pair = NextToken(at, '@');
+        const bool has_window = gap.find('@') != absl::string_view::npos;
+        if (std::count(gap_pair.begin(), gap_pair.end(), '-') != 1) {
           return absl::InvalidArgumentError(
               absl::StrCat("Improperly formed gap: ", gap));
         }
         TimeValue gap_lower, gap_upper;
-        if (!absl::SimpleAtoi(gap_pair[0], &gap_lower) ||
-            !absl::SimpleAtoi(gap_pair[1], &gap_upper)) {
+        if (!absl::SimpleAtoi(NextToken(gap_pair, '-'), &gap_lower) ||
+            !absl::SimpleAtoi(gap_pair, &gap_upper)) {
             return absl::InvalidArgumentError(
                 absl::StrCat("Improperly formed gap: ", gap));
         }
         std::optional<Window> window;
-        if (at.size() > 1) {
-          std::vector<absl::string_view> at_pair = absl::StrSplit(at[1], ':');
-          if (at_pair.size() != 2) {
+        if (has_window) {
+          absl::string_view at_pair = NextToken(at, '@');
+          if (std::count(at_pair.begin(), at_pair.end(), ':') != 1) {
             return absl::InvalidArgumentError(
                 absl::StrCat("Improperly formed gap: ", gap));
           }
           int64_t window_lower, window_upper;
-          if (!absl::SimpleAtoi(at_pair[0], &window_lower) ||
-              !absl::SimpleAtoi(at_pair[1], &window_upper)) {
+          if (!absl::SimpleAtoi(NextToken(at_pair, ':'), &window_lower) ||
+              !absl::SimpleAtoi(at_pair, &window_upper)) {
               return absl::InvalidArgumentError(
                   absl::StrCat("Improperly formed gap: ", gap));
           }
@@ -218,22 +324,180 @@ absl::StatusOr<Problem> FromCsv(absl::string_view input) {
       }
     }
     std::optional<Offset> offset;
-    if (col_map.contains(kOffset)) {
+    if (has_column[kOffsetColumn]) {
       int offset_val = -1;
-      if (!absl::SimpleAtoi(fields[col_map[kOffset]], &offset_val)) {
+      if (!absl::SimpleAtoi(fields[kOffsetColumn], &offset_val)) {
         return absl::InvalidArgumentError("Improperly formed offset");
       }
       offset = offset_val;
     }
-    problem.buffers.push_back({.id = id,
+    problem.buffers.push_back({.id = std::string(fields[kIdColumn]),
                                .lifespan = {lower, upper + addend},
                                .size = size,
                                .alignment = alignment,
-                               .gaps = gaps,
+                               .gaps = std::move(gaps),
                                .offset = offset,
                                .hint = hint});
   }
   return problem;
 }
 
+std::string ToBinary(const Problem& problem, Solution* solution) {
+  const auto& buffers = problem.buffers;
+  const int64_t num_buffers = buffers.size();
+  int64_t num_gaps = 0, num_id_bytes = 0;
+  for (const Buffer& buffer : buffers) {
+    num_gaps += buffer.gaps.size();
+    num_id_bytes += buffer.id.size();
+  }
+  BinaryHeader header = {.magic = {},
+                         .version = kVersion,
+                         .flags = 0,
+                         .capacity = problem.capacity,
+                         .num_buffers = num_buffers,
+                         .num_gaps = num_gaps,
+                         .num_id_bytes = num_id_bytes};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  int64_t num_columns = 6;
+  if (solution || std::any_of(buffers.begin(), buffers.end(),
+                              [](const Buffer& b) { return b.offset; })) {
+    header.flags |= kHasOffsets;
+    ++num_columns;
+  }
+  if (IncludeHint(problem)) {
+    header.flags |= kHasHints;
+    ++num_columns;
+  }
+  std::string output;
+  output.reserve(sizeof(header) + (num_columns * num_buffers + 2) * 8 +
+                 num_gaps * 4 * 8 + num_id_bytes);
+  output.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const Buffer& buffer : buffers) Append(output, buffer.lifespan.lower());
+  for (const Buffer& buffer : buffers) Append(output, buffer.lifespan.upper());
+  for (const Buffer& buffer : buffers) Append(output, buffer.size);
+  for (const Buffer& buffer : buffers) Append(output, buffer.alignment);
+  int64_t gap_begin = 0;
+  Append(output, gap_begin);
+  for (const Buffer& buffer : buffers) {
+    Append(output, gap_begin += buffer.gaps.size());
+  }
+  int64_t id_begin = 0;
+  Append(output, id_begin);
+  for (const Buffer& buffer : buffers) {
+    Append(output, id_begin += buffer.id.size());
+  }
+  if (header.flags & kHasOffsets) {
+    for (BufferIdx buffer_idx = 0; buffer_idx < num_buffers; ++buffer_idx) {
+      Append(output, solution ? solution->offsets[buffer_idx]
+                              : buffers[buffer_idx].offset.value_or(kAbsent));
+    }
+  }
+  if (header.flags & kHasHints) {
+    for (const Buffer& buffer : buffers) {
+      Append(output, buffer.hint.value_or(kAbsent));
+    }
+  }
+  for (const Buffer& buffer : buffers) {
+    for (const Gap& gap : buffer.gaps) Append(output, gap.lifespan.lower());
+  }
+  for (const Buffer& buffer : buffers) {
+    for (const Gap& gap : buffer.gaps) Append(output, gap.lifespan.upper());
+  }
+  for (const Buffer& buffer : buffers) {
+    for (const Gap& gap : buffer.gaps) {
+      Append(output, gap.window ? gap.window->lower() : kAbsent);
+    }
+  }
+  for (const Buffer& buffer : buffers) {
+    for (const Gap& gap : buffer.gaps) {
+      Append(output, gap.window ? gap.window->upper() : kAbsent);
+    }
+  }
+  for (const Buffer& buffer : buffers) output += buffer.id;
+  return output;
+}
+
+absl::StatusOr<Problem> FromBinary(absl::string_view input) {
+  if (!IsBinary(input) || input.size() < sizeof(BinaryHeader)) {
+    return absl::InvalidArgumentError("Missing binary header");
+  }
+  BinaryHeader header;
+  std::memcpy(&header, input.data(), sizeof(header));
+  input.remove_prefix(sizeof(header));
+  if (header.version != kVersion) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unsupported binary version: ", header.version));
+  }
+  if ((header.flags & ~(kHasOffsets | kHasHints)) || header.num_buffers < 0 ||
+      header.num_buffers > static_cast<int64_t>(input.size()) ||
+      header.num_gaps < 0 || header.num_id_bytes < 0) {
+    return absl::InvalidArgumentError("Malformed binary header");
+  }
+  const int64_t num_buffers = header.num_buffers;
+  const int64_t num_gaps = header.num_gaps;
+  const char* lowers = TakeColumn(input, num_buffers);
+  const char* uppers = lowers ? TakeColumn(input, num_buffers) : nullptr;
+  const char* sizes = uppers ? TakeColumn(input, num_buffers) : nullptr;
+  const char* alignments = sizes ? TakeColumn(input, num_buffers) : nullptr;
+  const char* gap_begins =
+      alignments ? TakeColumn(input, num_buffers + 1) : nullptr;
+  const char* id_begins =
+      gap_begins ? TakeColumn(input, num_buffers + 1) : nullptr;
+  const char* offsets = (id_begins && (header.flags & kHasOffsets))
+      ? TakeColumn(input, num_buffers) : nullptr;
+  const char* hints = (id_begins && (header.flags & kHasHints))
+      ? TakeColumn(input, num_buffers) : nullptr;
+  const char* gap_lowers = id_begins ? TakeColumn(input, num_gaps) : nullptr;
+  const char* gap_uppers = gap_lowers ? TakeColumn(input, num_gaps) : nullptr;
+  const char* window_lowers =
+      gap_uppers ? TakeColumn(input, num_gaps) : nullptr;
+  const char* window_uppers =
+      window_lowers ? TakeColumn(input, num_gaps) : nullptr;
+  if (!window_uppers || ((header.flags & kHasOffsets) && !offsets) ||
+      ((header.flags & kHasHints) && !hints) ||
+      input.size() != header.num_id_bytes) {
+    return absl::InvalidArgumentError("Binary input has the wrong length");
+  }
+  if (!IsMonotonic(gap_begins, num_buffers, num_gaps) ||
+      !IsMonotonic(id_begins, num_buffers, header.num_id_bytes)) {
+    return absl::InvalidArgumentError("Malformed binary offsets");
+  }
+  Problem problem = {.buffers = std::vector<Buffer>(num_buffers),
+                     .capacity = header.capacity};
+  for (BufferIdx buffer_idx = 0; buffer_idx < num_buffers; ++buffer_idx) {
+    Buffer& buffer = problem.buffers[buffer_idx];
+    const int64_t id_begin = Load(id_begins, buffer_idx);
+    const int64_t id_end = Load(id_begins, buffer_idx + 1);
+    buffer.id = std::string(input.substr(id_begin, id_end - id_begin));
+    buffer.lifespan = {Load(lowers, buffer_idx), Load(uppers, buffer_idx)};
+    buffer.size = Load(sizes, buffer_idx);
+    buffer.alignment = Load(alignments, buffer_idx);
+    const int64_t gap_begin = Load(gap_begins, buffer_idx);
+    const int64_t gap_end = Load(gap_begins, buffer_idx + 1);
+    buffer.gaps.reserve(gap_end - gap_begin);
+    for (int64_t gap_idx = gap_begin; gap_idx < gap_end; ++gap_idx) {
+      Gap& gap = buffer.gaps.emplace_back();
+      gap.lifespan = {Load(gap_lowers, gap_idx), Load(gap_uppers, gap_idx)};
+      const int64_t window_lower = Load(window_lowers, gap_idx);
+      if (window_lower != kAbsent) {
+        gap.window = {window_lower, Load(window_uppers, gap_idx)};
+      }
+    }
+    if (offsets) buffer.offset = ToOptional(Load(offsets, buffer_idx));
+    if (hints) buffer.hint = ToOptional(Load(hints, buffer_idx));
+  }
+  return problem;
+}
+
+bool IsBinary(absl::string_view input) {
+  return absl::StartsWith(input, absl::string_view(kMagic, sizeof(kMagic)));
+}
+
+absl::StatusOr<Problem> FromFile(const std::string& path) {
+  absl::StatusOr<MappedFile> file = MappedFile::Open(path);
+  if (!file.ok()) return file.status();
+  if (IsBinary(file->contents())) return FromBinary(file->contents());
+  return FromCsv(file->contents());
+}
+
 }  // namespace minimalloc
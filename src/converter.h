@@ -49,6 +49,35 @@ std::string ToCsv(const Problem& problem,
 // each buffer's offset or hint member field (respectively).
 absl::StatusOr<Problem> FromCsv(absl::string_view input);
 
+// Converts a Problem, along with an optional Solution, into a versioned binary
+// format made of fixed-width columns (in native byte order):
+//
+//      header:   magic, version, flags, capacity, #buffers, #gaps, #id bytes
+//      buffers:  lower[], upper[], size[], alignment[], gap_begin[], id_begin[]
+//                offset[] (if flagged), hint[] (if flagged)
+//      gaps:     lower[], upper[], window_lower[], window_upper[]
+//      ids:      the concatenated bytes of every buffer id
+//
+// Each begin column has one more entry than there are buffers, so that buffer i
+// owns the range [begin[i], begin[i + 1]).  Absent offsets, hints, and windows
+// are stored as INT64_MIN.  If a solution is provided, its offsets are written
+// into the offset column.
+std::string ToBinary(const Problem& problem, Solution* solution = nullptr);
+
+// Converts the binary format above into a Problem instance, or returns a status
+// if the input is truncated or otherwise malformed.  Columns are read directly
+// from the input without any text parsing, and then copied once into the
+// Problem's buffers, gaps, and ids.
+absl::StatusOr<Problem> FromBinary(absl::string_view input);
+
+// Returns true if the input begins with the magic number of the binary format.
+bool IsBinary(absl::string_view input);
+
+// Reads a file in either the binary or CSV format (detected from its contents),
+// which is memory mapped (when possible) and converted as above, straight from
+// the mapping into the Problem.
+absl::StatusOr<Problem> FromFile(const std::string& path);
+
 }  // namespace minimalloc
 
 #endif  // MINIMALLOC_SRC_CONVERTER_H_
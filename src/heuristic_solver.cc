@@ -0,0 +1,239 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "heuristic_solver.h"
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "minimalloc.h"
+#include "placement.h"
+#include "solver.h"
+#include "sweeper.h"
+
+namespace minimalloc {
+
+namespace {
+
+// The preordering heuristics used by the first-fit placements.
+constexpr char kSizeHeuristic[] = "ZWA";
+constexpr char kConflictHeuristic[] = "OZA";
+
+// Each neighborhood is solved for at most this fraction of the LNS timeout.
+constexpr int kNeighborhoodsPerTimeout = 32;
+
+// Collects up to 'num_buffers' buffers (without fixed offsets) that are
+// connected to the seed via overlaps, in breadth-first order (visiting the
+// overlaps of each buffer randomly).
+std::vector<BufferIdx> OverlapNeighborhood(const Problem& problem,
+                                           const SweepResult& sweep_result,
+                                           BufferIdx seed_idx, int num_buffers,
+                                           std::mt19937_64& rng) {
+  std::vector<BufferIdx> neighborhood = {seed_idx};
+  absl::flat_hash_set<BufferIdx> visited = {seed_idx};
+  std::vector<Overlap> overlaps;
+  for (int idx = 0; idx < neighborhood.size() &&
+      neighborhood.size() < num_buffers; ++idx) {
+    const BufferData& buffer_data =
+        sweep_result.buffer_data[neighborhood[idx]];
+    overlaps = buffer_data.overlaps;
+    std::shuffle(overlaps.begin(), overlaps.end(), rng);
+    for (const Overlap& overlap : overlaps) {
+      if (neighborhood.size() >= num_buffers) break;
+      if (problem.buffers[overlap.buffer_idx].offset) continue;
+      if (!visited.insert(overlap.buffer_idx).second) continue;
+      neighborhood.push_back(overlap.buffer_idx);
+    }
+  }
+  return neighborhood;
+}
+
+// Collects the 'num_buffers' buffers (without fixed offsets) whose lifespans
+// are nearest to that of the seed, breaking ties randomly.
+std::vector<BufferIdx> TimeNeighborhood(const Problem& problem,
+                                        BufferIdx seed_idx, int num_buffers,
+                                        std::mt19937_64& rng) {
+  const Lifespan& seed_lifespan = problem.buffers[seed_idx].lifespan;
+  std::vector<std::tuple<TimeValue, uint64_t, BufferIdx>> candidates;
+  for (BufferIdx buffer_idx = 0; buffer_idx < problem.buffers.size();
+      ++buffer_idx) {
+    const Buffer& buffer = problem.buffers[buffer_idx];
+    if (buffer.offset) continue;
+    const TimeValue distance = std::max(
+        {buffer.lifespan.lower() - seed_lifespan.upper(),
+         seed_lifespan.lower() - buffer.lifespan.upper(), TimeValue{0}});
+    candidates.push_back({buffer_idx == seed_idx ? -1 : distance, rng(),
+                          buffer_idx});
+  }
+  const auto size = std::min<size_t>(num_buffers, candidates.size());
+  std::nth_element(candidates.begin(), candidates.begin() + size,
+                   candidates.end());
+  std::vector<BufferIdx> neighborhood;
+  for (size_t idx = 0; idx < size; ++idx) {
+    neighborhood.push_back(std::get<2>(candidates[idx]));
+  }
+  return neighborhood;
+}
+
+}  // namespace
+
+HeuristicSolver::HeuristicSolver() = default;
+
+HeuristicSolver::HeuristicSolver(const SolverParams& params)
+    : params_(params) {}
+
+absl::StatusOr<Solution> HeuristicSolver::Solve(const Problem& problem) {
+  best_solution_.reset();
+  const SweepResult sweep_result =
+      SweepWithThreads(problem, params_.sweep_threads);
+  const std::vector<PreorderData> preordering =
+      CalcPreordering(problem, sweep_result);
+  const auto sorted = [&](const PreorderingHeuristic& preordering_heuristic) {
+    std::vector<PreorderData> sorted_preordering = preordering;
+    absl::c_sort(sorted_preordering,
+                 PreorderingComparator(preordering_heuristic));
+    return sorted_preordering;
+  };
+  for (const GreedyHeuristic& greedy_heuristic : params_.greedy_heuristics) {
+    Solution solution;
+    if (greedy_heuristic == "size") {
+      solution = PlaceFirstFit(problem, sweep_result, sorted(kSizeHeuristic));
+    } else if (greedy_heuristic == "conflict") {
+      solution =
+          PlaceFirstFit(problem, sweep_result, sorted(kConflictHeuristic));
+    } else if (greedy_heuristic == "skyline") {
+      solution = PlaceOnSkyline(problem, sweep_result,
+                                sorted(params_.preordering_heuristics.front()));
+    } else {
+      return absl::InvalidArgumentError("Unknown greedy heuristic.");
+    }
+    if (best_solution_ &&
+        problem.peak(*best_solution_) <= problem.peak(solution)) {
+      continue;
+    }
+    best_solution_ = std::move(solution);
+  }
+  if (best_solution_ && params_.lns_timeout > absl::ZeroDuration()) {
+    best_solution_ = ImproveWithSweepResult(problem, sweep_result,
+                                            *std::move(best_solution_));
+  }
+  if (!best_solution_ || problem.peak(*best_solution_) > problem.capacity) {
+    return absl::NotFoundError("No greedy solution fits within the capacity.");
+  }
+  return *best_solution_;
+}
+
+Solution HeuristicSolver::Improve(const Problem& problem, Solution solution) {
+  return ImproveWithSweepResult(
+      problem, SweepWithThreads(problem, params_.sweep_threads),
+      std::move(solution));
+}
+
+Solution HeuristicSolver::ImproveWithSweepResult(
+    const Problem& problem, const SweepResult& sweep_result,
+    Solution solution) {
+  const absl::Time deadline = absl::Now() + params_.lns_timeout;
+  const Capacity lower_bound = CalcCapacityLowerBound(problem, sweep_result);
+  std::mt19937_64 rng(params_.seed);
+  SolverParams params = params_;
+  params.anytime = false;
+  params.hint_first = true;  // Probe the current layout of each neighborhood.
+  std::vector<bool> freed(problem.buffers.size());
+  for (int64_t iteration = 0; ; ++iteration) {
+    const absl::Time now = absl::Now();
+    if (now >= deadline) break;
+    const Capacity peak = problem.peak(solution);
+    if (peak <= lower_bound) break;
+    // Each neighborhood must contain a buffer that reaches the peak (which is
+    // then solved beneath it), else no progress can be made.
+    std::vector<BufferIdx> peak_idxs;
+    bool fixed_at_peak = false;
+    for (BufferIdx buffer_idx = 0; buffer_idx < problem.buffers.size();
+        ++buffer_idx) {
+      const Buffer& buffer = problem.buffers[buffer_idx];
+      if (solution.offsets[buffer_idx] + buffer.size < peak) continue;
+      if (buffer.offset) fixed_at_peak = true;
+      peak_idxs.push_back(buffer_idx);
+    }
+    if (fixed_at_peak) break;  // No neighborhood could lower this peak.
+    const BufferIdx seed_idx = peak_idxs[rng() % peak_idxs.size()];
+    std::vector<BufferIdx> neighborhood = iteration % 2 == 0
+        ? OverlapNeighborhood(problem, sweep_result, seed_idx,
+                              params_.lns_buffers, rng)
+        : TimeNeighborhood(problem, seed_idx, params_.lns_buffers, rng);
+    // Any overlapping buffer that also reaches the peak joins the neighborhood
+    // (even beyond its size limit), since holding it would leave the subproblem
+    // infeasible from the outset.
+    for (const BufferIdx buffer_idx : neighborhood) freed[buffer_idx] = true;
+    for (int idx = 0; idx < neighborhood.size(); ++idx) {
+      const BufferData& buffer_data =
+          sweep_result.buffer_data[neighborhood[idx]];
+      for (const Overlap& overlap : buffer_data.overlaps) {
+        const BufferIdx other_idx = overlap.buffer_idx;
+        if (freed[other_idx]) continue;
+        const Buffer& other = problem.buffers[other_idx];
+        if (solution.offsets[other_idx] + other.size < peak) continue;
+        freed[other_idx] = true;
+        neighborhood.push_back(other_idx);
+      }
+    }
+    // The subproblem consists of the neighborhood (hinted at its current
+    // offsets), plus any overlapping buffers held at their current offsets.
+    Problem subproblem = {.capacity = peak - 1};
+    for (const BufferIdx buffer_idx : neighborhood) {
+      Buffer& buffer = subproblem.buffers.emplace_back(
+          problem.buffers[buffer_idx]);
+      buffer.hint = solution.offsets[buffer_idx];
+    }
+    absl::flat_hash_set<BufferIdx> held;
+    for (const BufferIdx buffer_idx : neighborhood) {
+      const BufferData& buffer_data = sweep_result.buffer_data[buffer_idx];
+      for (const Overlap& overlap : buffer_data.overlaps) {
+        const BufferIdx other_idx = overlap.buffer_idx;
+        if (freed[other_idx] || !held.insert(other_idx).second) continue;
+        Buffer& buffer = subproblem.buffers.emplace_back(
+            problem.buffers[other_idx]);
+        buffer.offset = solution.offsets[other_idx];
+      }
+    }
+    for (const BufferIdx buffer_idx : neighborhood) freed[buffer_idx] = false;
+    params.timeout = std::min(deadline - now,
+                              params_.lns_timeout / kNeighborhoodsPerTimeout);
+    Solver solver(params);
+    const absl::StatusOr<Solution> subsolution = solver.Solve(subproblem);
+    if (!subsolution.ok()) continue;
+    for (int idx = 0; idx < neighborhood.size(); ++idx) {
+      solution.offsets[neighborhood[idx]] = subsolution->offsets[idx];
+    }
+  }
+  return solution;
+}
+
+const std::optional<Solution>& HeuristicSolver::get_best_solution() const {
+  return best_solution_;
+}
+
+}  // namespace minimalloc
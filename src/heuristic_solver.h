@@ -0,0 +1,63 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef MINIMALLOC_SRC_HEURISTIC_SOLVER_H_
+#define MINIMALLOC_SRC_HEURISTIC_SOLVER_H_
+
+#include <optional>
+#include <vector>
+
+#include "minimalloc.h"
+#include "solver.h"
+#include "sweeper.h"
+#include "absl/status/statusor.h"
+
+namespace minimalloc {
+
+// A fast (albeit incomplete) alternative to the Solver for very large problems,
+// which attempts each of the greedy heuristics in SolverParams (sharing a
+// single sweep) without any backtracking, and optionally improves upon the
+// best of them using large neighborhood search.
+class HeuristicSolver {
+ public:
+  HeuristicSolver();
+  explicit HeuristicSolver(const SolverParams& params);
+
+  // Returns the solution with the lowest peak, or a NotFound error if it
+  // exceeds the problem's capacity.
+  absl::StatusOr<Solution> Solve(const Problem& problem);
+
+  // Lowers the peak of a solution (whose buffers mustn't overlap) via large
+  // neighborhood search, until either the LNS timeout elapses or the peak meets
+  // a lower bound.
+  Solution Improve(const Problem& problem, Solution solution);
+
+  // Returns the solution with the lowest peak found in the latest invocation,
+  // which may exceed the problem's capacity.
+  const std::optional<Solution>& get_best_solution() const;
+
+ private:
+  Solution ImproveWithSweepResult(const Problem& problem,
+                                  const SweepResult& sweep_result,
+                                  Solution solution);
+
+  const SolverParams params_;
+  std::optional<Solution> best_solution_;
+};
+
+}  // namespace minimalloc
+
+#endif  // MINIMALLOC_SRC_HEURISTIC_SOLVER_H_
@@ -21,9 +21,10 @@ limitations under the License.
 #include <iomanip>
 #include <ios>
 #include <iostream>
-#include <iterator>
+#include <optional>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
@@ -33,16 +34,28 @@ limitations under the License.
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "converter.h"
+#include "heuristic_solver.h"
 #include "minimalloc.h"
 #include "solver.h"
+#include "thread_pool.h"
 #include "validator.h"
 
-ABSL_FLAG(int64_t, capacity, 0, "The maximum memory capacity.");
-ABSL_FLAG(std::string, input, "", "The path to the input CSV file.");
+ABSL_FLAG(std::optional<int64_t>, capacity, std::nullopt,
+          "The maximum memory capacity (if not given by a binary input).");
+ABSL_FLAG(std::string, input, "",
+          "The path to the input file (in either the CSV or binary format).");
 ABSL_FLAG(std::string, output, "", "The path to the output CSV file.");
+ABSL_FLAG(bool, binary_output, false,
+          "Writes the output in the binary format (rather than as a CSV).");
 ABSL_FLAG(absl::Duration, timeout, absl::InfiniteDuration(),
           "The time limit enforced for the MiniMalloc solver.");
 ABSL_FLAG(bool, validate, false, "Validates the solver's output.");
+ABSL_FLAG(bool, validate_input, false,
+          "Validates the offsets given in the input (rather than solving).");
+ABSL_FLAG(std::string, validation_report, "",
+          "The path to a CSV file that lists every violation found.");
+ABSL_FLAG(int, validation_threads, 1,
+          "The number of threads that check for overlapping buffers.");
 
 ABSL_FLAG(bool, canonical_only, true, "Explores canonical solutions only.");
 ABSL_FLAG(bool, section_inference, true, "Performs advanced inference.");
@@ -60,6 +73,36 @@ ABSL_FLAG(bool, hatless_pruning, true,
 
 ABSL_FLAG(std::string, preordering_heuristics, "WAT,TAW,TWA",
           "Static preordering heuristics to attempt.");
+ABSL_FLAG(bool, parallel_portfolio, false,
+          "Attempts the preordering heuristics concurrently.");
+ABSL_FLAG(int, search_threads, 1,
+          "The number of threads that cooperatively search each partition.");
+ABSL_FLAG(int, partition_threads, 1,
+          "The number of threads that solve independent partitions.");
+ABSL_FLAG(int, sweep_threads, 1,
+          "The number of threads that sweep the problem before searching.");
+
+ABSL_FLAG(bool, hint_first, false,
+          "Explores buffers at their hinted offsets (if any) first.");
+ABSL_FLAG(int64_t, transposition_bytes, 64 << 20,
+          "The memory budget for recording the outcomes of sub-partitions.");
+ABSL_FLAG(bool, randomized_restarts, false,
+          "Restarts the search with random tie-breaking as node limits grow.");
+ABSL_FLAG(bool, luby_restarts, false,
+          "Grows the node limits of restarts via the Luby sequence.");
+ABSL_FLAG(uint64_t, seed, 0, "Seeds the random tie-breaking of restarts.");
+ABSL_FLAG(bool, anytime, false,
+          "Outputs the best solution found (even above capacity) if none fits.");
+ABSL_FLAG(bool, heuristic, false,
+          "Places buffers greedily (without searching) for very large inputs.");
+ABSL_FLAG(std::string, greedy_heuristics, "size,conflict,skyline",
+          "Greedy placements attempted by the heuristic solver.");
+ABSL_FLAG(absl::Duration, lns_timeout, absl::ZeroDuration(),
+          "Time spent improving heuristic solutions via neighborhood search.");
+ABSL_FLAG(int, lns_buffers, 32,
+          "The number of buffers freed in each neighborhood.");
+ABSL_FLAG(bool, minimize_capacity, false,
+          "Finds the smallest capacity (up to --capacity) that is feasible.");
 
 ABSL_FLAG(bool, print_solution, false, "Prints the solution in LaTeX");
 
@@ -114,6 +157,50 @@ void PrintSolution(const minimalloc::Problem& problem,
   os << "\\end{document}" << std::endl;
 }
 
+// Writes each violation as a CSV row, with buffers identified by their ids.
+void WriteValidationReport(const minimalloc::Problem& problem,
+                           const std::vector<minimalloc::Violation>& violations,
+                           std::ostream& os) {
+  const auto buffer_id = [&](minimalloc::BufferIdx buffer_idx) {
+    return buffer_idx < 0 ? "" : problem.buffers[buffer_idx].id;
+  };
+  os << "violation,buffer,other_buffer,lower,upper,offset_lower,offset_upper,"
+     << "expected" << std::endl;
+  for (const minimalloc::Violation& violation : violations) {
+    switch (violation.result) {
+      case minimalloc::kBadSolution: os << "solution"; break;
+      case minimalloc::kBadFixed: os << "fixed"; break;
+      case minimalloc::kBadOffset: os << "offset"; break;
+      case minimalloc::kBadOverlap: os << "overlap"; break;
+      case minimalloc::kBadAlignment: os << "alignment"; break;
+      case minimalloc::kGood: break;
+    }
+    os << "," << buffer_id(violation.buffer_idx)
+       << "," << buffer_id(violation.other_buffer_idx)
+       << "," << violation.lifespan.lower() << "," << violation.lifespan.upper()
+       << "," << violation.offsets.lower() << "," << violation.offsets.upper()
+       << "," << violation.expected << std::endl;
+  }
+}
+
+// Validates a solution, reporting any violations found.  Returns true if valid.
+bool ValidateSolution(const minimalloc::Problem& problem,
+                      const minimalloc::Solution& solution) {
+  const int num_threads = absl::GetFlag(FLAGS_validation_threads);
+  std::optional<minimalloc::ThreadPool> thread_pool;
+  if (num_threads > 1) thread_pool.emplace(num_threads - 1);
+  const std::vector<minimalloc::Violation> violations =
+      minimalloc::ValidateDetailed(problem, solution,
+                                   thread_pool ? &*thread_pool : nullptr);
+  std::cerr << (violations.empty() ? "PASS" : "FAIL") << std::endl;
+  const std::string report = absl::GetFlag(FLAGS_validation_report);
+  if (!report.empty()) {
+    std::ofstream ofs(report);
+    WriteValidationReport(problem, violations, ofs);
+  }
+  return violations.empty();
+}
+
 // Solves a given problem using the Solver.
 int main(int argc, char* argv[]) {
   absl::ParseCommandLine(argc, argv);
@@ -130,29 +217,68 @@ int main(int argc, char* argv[]) {
       .hatless_pruning = absl::GetFlag(FLAGS_hatless_pruning),
       .preordering_heuristics = absl::StrSplit(
           absl::GetFlag(FLAGS_preordering_heuristics), ',', absl::SkipEmpty()),
+      .parallel_portfolio = absl::GetFlag(FLAGS_parallel_portfolio),
+      .search_threads = absl::GetFlag(FLAGS_search_threads),
+      .partition_threads = absl::GetFlag(FLAGS_partition_threads),
+      .sweep_threads = absl::GetFlag(FLAGS_sweep_threads),
+      .hint_first = absl::GetFlag(FLAGS_hint_first),
+      .transposition_bytes = absl::GetFlag(FLAGS_transposition_bytes),
+      .randomized_restarts = absl::GetFlag(FLAGS_randomized_restarts),
+      .luby_restarts = absl::GetFlag(FLAGS_luby_restarts),
+      .seed = absl::GetFlag(FLAGS_seed),
+      .anytime = absl::GetFlag(FLAGS_anytime),
+      .greedy_heuristics = absl::StrSplit(
+          absl::GetFlag(FLAGS_greedy_heuristics), ',', absl::SkipEmpty()),
+      .lns_timeout = absl::GetFlag(FLAGS_lns_timeout),
+      .lns_buffers = absl::GetFlag(FLAGS_lns_buffers),
   };
-  std::ifstream ifs(absl::GetFlag(FLAGS_input));
-  std::string csv((std::istreambuf_iterator<char>(ifs)),
-                  (std::istreambuf_iterator<char>()   ));
-  absl::StatusOr<minimalloc::Problem> problem = minimalloc::FromCsv(csv);
+  absl::StatusOr<minimalloc::Problem> problem =
+      minimalloc::FromFile(absl::GetFlag(FLAGS_input));
   if (!problem.ok()) return 1;
-  problem->capacity = absl::GetFlag(FLAGS_capacity);
+  // A binary input carries its own capacity, which the flag may override.
+  if (const std::optional<int64_t> capacity = absl::GetFlag(FLAGS_capacity)) {
+    problem->capacity = *capacity;
+  }
+  if (absl::GetFlag(FLAGS_validate_input)) {
+    absl::StatusOr<minimalloc::Solution> solution = problem->strip_solution();
+    if (!solution.ok()) return 1;
+    return ValidateSolution(*problem, *solution) ? 0 : 1;
+  }
   minimalloc::Solver solver(params);
+  minimalloc::HeuristicSolver heuristic_solver(params);
+  const bool heuristic = absl::GetFlag(FLAGS_heuristic);
   const absl::Time start_time = absl::Now();
-  absl::StatusOr<minimalloc::Solution> solution = solver.Solve(*problem);
+  const bool minimize_capacity = absl::GetFlag(FLAGS_minimize_capacity);
+  absl::StatusOr<minimalloc::Solution> solution =
+      heuristic           ? heuristic_solver.Solve(*problem)
+      : minimize_capacity ? solver.MinimizeCapacity(*problem)
+                          : solver.Solve(*problem);
   const absl::Time end_time = absl::Now();
   std::cerr << std::fixed << std::setprecision(3)
       << absl::ToDoubleSeconds(end_time - start_time);
+  const std::optional<minimalloc::Solution>& best_solution =
+      heuristic ? heuristic_solver.get_best_solution()
+                : solver.get_best_solution();
+  // Only fall back on the best solution found (which exceeds the capacity) if
+  // asked to, i.e., in anytime mode or when minimizing the heuristic's peak.
+  const bool fallback =
+      absl::GetFlag(FLAGS_anytime) || (heuristic && minimize_capacity);
+  if (!solution.ok() && fallback && best_solution) {
+    solution = *best_solution;
+    std::cerr << " peak=" << problem->peak(*solution) << " ";
+  }
   if (!solution.ok()) return 1;
-  if (absl::GetFlag(FLAGS_validate)) {
-    minimalloc::ValidationResult validation_result =
-        minimalloc::Validate(*problem, *solution);
-    std::cerr << (validation_result == minimalloc::ValidationResult::kGood
-        ? "PASS" : "FAIL") << std::endl;
+  if (minimize_capacity) {
+    problem->capacity = problem->peak(*solution);
+    std::cerr << " capacity=" << problem->capacity << " ";
   }
+  if (absl::GetFlag(FLAGS_validate)) ValidateSolution(*problem, *solution);
   if (absl::GetFlag(FLAGS_print_solution)) PrintSolution(*problem, *solution);
-  std::string contents = minimalloc::ToCsv(*problem, &(*solution));
-  std::ofstream ofs(absl::GetFlag(FLAGS_output));
+  std::string contents =
+      absl::GetFlag(FLAGS_binary_output)
+          ? minimalloc::ToBinary(*problem, &(*solution))
+          : minimalloc::ToCsv(*problem, &(*solution));
+  std::ofstream ofs(absl::GetFlag(FLAGS_output), std::ios::binary);
   ofs << contents;
   ofs.close();
   return 0;
@@ -0,0 +1,77 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+
+namespace minimalloc {
+
+absl::StatusOr<MappedFile> MappedFile::Open(const std::string& path) {
+  MappedFile file;
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return absl::NotFoundError(absl::StrCat("Cannot open ", path));
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+      file.data_ = static_cast<const char*>(data);
+      file.size_ = st.st_size;
+      file.mapped_ = true;
+    }
+  }
+  close(fd);
+  if (!file.mapped_) {  // E.g., for pipes or empty files, just read them in.
+    std::ifstream ifs(path, std::ios::binary);
+    file.buffer_.assign(std::istreambuf_iterator<char>(ifs),
+                        std::istreambuf_iterator<char>());
+    file.data_ = file.buffer_.data();
+    file.size_ = file.buffer_.size();
+  }
+  return file;
+}
+
+MappedFile::MappedFile(MappedFile&& x) { *this = std::move(x); }
+
+MappedFile& MappedFile::operator=(MappedFile&& x) {
+  if (this == &x) return *this;
+  if (mapped_) munmap(const_cast<char*>(data_), size_);
+  mapped_ = std::exchange(x.mapped_, false);
+  size_ = std::exchange(x.size_, 0);
+  buffer_ = std::move(x.buffer_);
+  data_ = mapped_ ? x.data_ : buffer_.data();
+  x.data_ = nullptr;
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  if (mapped_) munmap(const_cast<char*>(data_), size_);
+}
+
+}  // namespace minimalloc
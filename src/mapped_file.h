@@ -0,0 +1,51 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef MINIMALLOC_SRC_MAPPED_FILE_H_
+#define MINIMALLOC_SRC_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace minimalloc {
+
+// Provides read-only access to the contents of a file, which are mapped into
+// memory (rather than copied) whenever possible.
+class MappedFile {
+ public:
+  static absl::StatusOr<MappedFile> Open(const std::string& path);
+
+  MappedFile(MappedFile&& x);
+  MappedFile& operator=(MappedFile&& x);
+  ~MappedFile();
+
+  absl::string_view contents() const { return {data_, size_}; }
+
+ private:
+  MappedFile() = default;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;  // If not, the contents were read into 'buffer_'.
+  std::string buffer_;
+};
+
+}  // namespace minimalloc
+
+#endif  // MINIMALLOC_SRC_MAPPED_FILE_H_
@@ -43,6 +43,78 @@ struct Point {
   }
 };
 
+// Returns 'true' if a buffer's lifespan & gaps are nonempty, and its gaps are in
+// order, disjoint, and lie within its lifespan.  If so, its lifespan divides
+// into 2 * |gaps| + 1 consecutive segments: the even ones between gaps, and the
+// odd ones within them.
+bool HasOrderedGaps(const Buffer& buffer) {
+  if (buffer.lifespan.upper() <= buffer.lifespan.lower()) return false;
+  TimeValue time_value = buffer.lifespan.lower();
+  for (const Gap& gap : buffer.gaps) {
+    if (gap.lifespan.lower() < time_value) return false;
+    if (gap.lifespan.upper() <= gap.lifespan.lower()) return false;
+    time_value = gap.lifespan.upper();
+  }
+  return time_value <= buffer.lifespan.upper();
+}
+
+TimeValue SegmentLower(const Buffer& buffer, int segment_idx) {
+  const int gap_idx = segment_idx / 2;
+  if (segment_idx % 2) return buffer.gaps[gap_idx].lifespan.lower();
+  return gap_idx ? buffer.gaps[gap_idx - 1].lifespan.upper()
+                 : buffer.lifespan.lower();
+}
+
+TimeValue SegmentUpper(const Buffer& buffer, int segment_idx) {
+  const int gap_idx = segment_idx / 2;
+  if (segment_idx % 2) return buffer.gaps[gap_idx].lifespan.upper();
+  return gap_idx < buffer.gaps.size() ? buffer.gaps[gap_idx].lifespan.lower()
+                                      : buffer.lifespan.upper();
+}
+
+std::optional<Window> SegmentWindow(const Buffer& buffer, int segment_idx) {
+  if (segment_idx % 2) return buffer.gaps[segment_idx / 2].window;
+  return Window{0, buffer.size};
+}
+
+// Calculates the effective size of buffer 'a' (given buffer 'x' directly above)
+// by sweeping over all of their (sorted) endpoints, which is needed whenever
+// their gaps are out of order, overlap, or are empty (or a lifespan is empty).
+std::optional<int64_t> SweepEffectiveSize(const Buffer& a, const Buffer& x) {
+  const Lifespan& lifespan = a.lifespan;
+  const int64_t size = a.size;
+  const std::vector<Gap>& gaps = a.gaps;
+  const Window window = {0, size};
+  const Window x_window = {0, x.size};
+  std::vector<Point> points = {{0, lifespan.lower(), kLeft, window},
+                               {0, lifespan.upper(), kRight, std::nullopt},
+                               {1, x.lifespan.lower(), kLeft, x_window},
+                               {1, x.lifespan.upper(), kRight, std::nullopt}};
+  for (const Gap& gap : gaps) {
+    points.push_back({0, gap.lifespan.lower(), kRightGap, gap.window});
+    points.push_back({0, gap.lifespan.upper(), kLeftGap, window});
+  }
+  for (const Gap& gap : x.gaps) {
+    points.push_back({1, gap.lifespan.lower(), kRightGap, gap.window});
+    points.push_back({1, gap.lifespan.upper(), kLeftGap, x_window});
+  }
+  std::sort(points.begin(), points.end());
+  std::optional<Window> windows[2];
+  std::optional<int64_t> effective_size;
+  std::optional<TimeValue> last_time;
+  for (const Point& point : points) {
+    if (last_time && point.time_value > *last_time) {  // We've moved right
+      if (windows[0] && windows[1]) {  // Both buffers are active, let's check
+        const int64_t diff = windows[0]->upper() - windows[1]->lower();
+        if (!effective_size || *effective_size < diff) effective_size = diff;
+      }
+    }
+    last_time = point.time_value;
+    windows[point.buffer_idx] = point.window;
+  }
+  return effective_size;
+}
+
 }  // namespace
 
 bool Gap::operator==(const Gap& x) const {
@@ -74,33 +146,29 @@ Area Buffer::area() const {
 std::optional<int64_t> Buffer::effective_size(const Buffer& x) const {
   if (lifespan.upper() <= x.lifespan.lower()) return std::nullopt;
   if (x.lifespan.upper() <= lifespan.lower()) return std::nullopt;
-  const Window window = {0, size};
-  const Window x_window = {0, x.size};
-  std::vector<Point> points = {{0, lifespan.lower(), kLeft, window},
-                               {0, lifespan.upper(), kRight, std::nullopt},
-                               {1, x.lifespan.lower(), kLeft, x_window},
-                               {1, x.lifespan.upper(), kRight, std::nullopt}};
-  for (const Gap& gap : gaps) {
-    points.push_back({0, gap.lifespan.lower(), kRightGap, gap.window});
-    points.push_back({0, gap.lifespan.upper(), kLeftGap, window});
+  if (!HasOrderedGaps(*this) || !HasOrderedGaps(x)) {
+    return SweepEffectiveSize(*this, x);
   }
-  for (const Gap& gap : x.gaps) {
-    points.push_back({1, gap.lifespan.lower(), kRightGap, gap.window});
-    points.push_back({1, gap.lifespan.upper(), kLeftGap, x_window});
-  }
-  std::sort(points.begin(), points.end());
-  std::optional<Window> windows[2];
+  // Without gaps, both buffers are active throughout their overlap.
+  if (gaps.empty() && x.gaps.empty()) return size;
+  // Walk both buffers' segments in step, examining each pair that intersects.
   std::optional<int64_t> effective_size;
-  std::optional<TimeValue> last_time;
-  for (const Point& point : points) {
-    if (last_time && point.time_value > *last_time) {  // We've moved right
-      if (windows[0] && windows[1]) {  // Both buffers are active, let's check
-        const int64_t diff = windows[0]->upper() - windows[1]->lower();
+  const int num_segments = 2 * gaps.size() + 1;
+  const int x_num_segments = 2 * x.gaps.size() + 1;
+  for (int idx = 0, x_idx = 0; idx < num_segments && x_idx < x_num_segments;) {
+    const TimeValue upper = SegmentUpper(*this, idx);
+    const TimeValue x_upper = SegmentUpper(x, x_idx);
+    if (std::max(SegmentLower(*this, idx), SegmentLower(x, x_idx)) <
+        std::min(upper, x_upper)) {
+      const std::optional<Window> window = SegmentWindow(*this, idx);
+      const std::optional<Window> x_window = SegmentWindow(x, x_idx);
+      if (window && x_window) {
+        const int64_t diff = window->upper() - x_window->lower();
         if (!effective_size || *effective_size < diff) effective_size = diff;
       }
     }
-    last_time = point.time_value;
-    windows[point.buffer_idx] = point.window;
+    if (upper <= x_upper) ++idx;
+    if (x_upper <= upper) ++x_idx;
   }
   return effective_size;
 }
@@ -117,4 +185,13 @@ absl::StatusOr<Solution> Problem::strip_solution() {
   return solution;
 }
 
+Capacity Problem::peak(const Solution& solution) const {
+  Capacity peak = 0;
+  for (BufferIdx buffer_idx = 0; buffer_idx < buffers.size(); ++buffer_idx) {
+    const Offset offset = solution.offsets[buffer_idx];
+    peak = std::max(peak, offset + buffers[buffer_idx].size);
+  }
+  return peak;
+}
+
 }  // namespace minimalloc
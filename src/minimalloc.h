@@ -95,6 +95,9 @@ struct Problem {
   // Extracts a solution from the offset value of each buffer, which is cleared.
   absl::StatusOr<Solution> strip_solution();
 
+  // The peak memory usage of a solution (i.e., its highest offset + size).
+  Capacity peak(const Solution& solution) const;
+
   bool operator==(const Problem& x) const;
 };
 
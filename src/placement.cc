@@ -0,0 +1,233 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "placement.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "minimalloc.h"
+#include "sweeper.h"
+
+namespace minimalloc {
+
+namespace {
+
+constexpr Offset kNoOffset = -1;
+
+// Rounds an offset up to the nearest multiple of the given alignment.
+Offset Align(Offset offset, Offset alignment) {
+  if (const Offset diff = offset % alignment; diff > 0) {
+    offset += alignment - diff;
+  }
+  return offset;
+}
+
+// A range of offsets [lower, upper) at which some buffer may not be placed.
+struct Blocked {
+  Offset lower;
+  Offset upper;
+};
+
+// A buffer that has been placed, along with its height from the perspective of
+// some overlapping buffer to be placed above it.
+struct Placed {
+  BufferIdx buffer_idx;
+  Offset height;
+};
+
+}  // namespace
+
+PreorderData CalcPreorderData(const Problem& problem,
+                              const SweepResult& sweep_result,
+                              const std::vector<Offset>& section_totals,
+                              BufferIdx buffer_idx, uint64_t rank) {
+  const Buffer& buffer = problem.buffers[buffer_idx];
+  Offset total = 0;
+  const BufferData& buffer_data = sweep_result.buffer_data[buffer_idx];
+  const std::vector<SectionSpan>& section_spans = buffer_data.section_spans;
+  for (const SectionSpan& section_span : section_spans) {
+    const SectionRange& section_range = section_span.section_range;
+    for (SectionIdx s_idx = section_range.lower();
+        s_idx < section_range.upper(); ++s_idx) {
+      total = std::max(total, section_totals[s_idx]);
+    }
+  }
+  int sections = section_spans.back().section_range.upper() -
+                 section_spans.front().section_range.lower();
+  return {
+    .area = buffer.area(),
+    .lower = buffer.lifespan.lower(),
+    .overlaps = buffer_data.overlaps.size(),
+    .sections = sections,
+    .size = buffer.size,
+    .total = static_cast<int>(total),
+    .upper = buffer.lifespan.upper(),
+    .width = buffer.lifespan.upper() - buffer.lifespan.lower(),
+    .rank = rank,
+    .buffer_idx = buffer_idx};
+}
+
+std::vector<PreorderData> CalcPreordering(const Problem& problem,
+                                          const SweepResult& sweep_result) {
+  const auto num_buffers = problem.buffers.size();
+  std::vector<Offset> section_totals(sweep_result.sections.size());
+  for (BufferIdx buffer_idx = 0; buffer_idx < num_buffers; ++buffer_idx) {
+    const BufferData& buffer_data = sweep_result.buffer_data[buffer_idx];
+    for (const SectionSpan& section_span : buffer_data.section_spans) {
+      const SectionRange& section_range = section_span.section_range;
+      const Window& window = section_span.window;
+      for (SectionIdx s_idx = section_range.lower();
+          s_idx < section_range.upper(); ++s_idx) {
+        section_totals[s_idx] += window.upper() - window.lower();
+      }
+    }
+  }
+  std::vector<PreorderData> preordering;
+  preordering.reserve(num_buffers);
+  for (BufferIdx buffer_idx = 0; buffer_idx < num_buffers; ++buffer_idx) {
+    preordering.push_back(CalcPreorderData(problem, sweep_result,
+                                           section_totals, buffer_idx,
+                                           /*rank=*/0));
+  }
+  return preordering;
+}
+
+PreorderingComparator::PreorderingComparator(const PreorderingHeuristic& h) :
+    preordering_heuristic_(h) {}
+
+bool PreorderingComparator::operator()(
+    const PreorderData& a, const PreorderData& b) const {
+  for (const char &c : preordering_heuristic_) {
+    if (c == 'A' && a.area != b.area) return a.area > b.area;
+    if (c == 'C' && a.sections != b.sections) return a.sections > b.sections;
+    if (c == 'L' && a.lower != b.lower) return a.lower > b.lower;
+    if (c == 'O' && a.overlaps != b.overlaps) return a.overlaps > b.overlaps;
+    if (c == 'T' && a.total != b.total) return a.total > b.total;
+    if (c == 'U' && a.upper != b.upper) return a.upper > b.upper;
+    if (c == 'W' && a.width != b.width) return a.width > b.width;
+    if (c == 'Z' && a.size != b.size) return a.size > b.size;
+  }
+  if (a.rank != b.rank) return a.rank < b.rank;
+  return a.buffer_idx < b.buffer_idx;
+}
+
+Solution PlaceFirstFit(const Problem& problem, const SweepResult& sweep_result,
+                       const std::vector<PreorderData>& preordering) {
+  const auto num_buffers = problem.buffers.size();
+  Solution solution;
+  solution.offsets.resize(num_buffers, kNoOffset);
+  // The placed buffers that overlap each unallocated buffer.
+  std::vector<std::vector<Placed>> placed(num_buffers);
+  const auto place = [&](BufferIdx buffer_idx, Offset offset) {
+    solution.offsets[buffer_idx] = offset;
+    const BufferData& buffer_data = sweep_result.buffer_data[buffer_idx];
+    for (const Overlap& overlap : buffer_data.overlaps) {
+      const BufferIdx other_idx = overlap.buffer_idx;
+      if (solution.offsets[other_idx] != kNoOffset) continue;
+      placed[other_idx].push_back(
+          {.buffer_idx = buffer_idx,
+           .height = offset + overlap.effective_size});
+    }
+  };
+  for (const PreorderData& preorder_data : preordering) {
+    const Buffer& buffer = problem.buffers[preorder_data.buffer_idx];
+    if (buffer.offset) place(preorder_data.buffer_idx, *buffer.offset);
+  }
+  // The effective size of the buffer being placed beneath each other buffer.
+  std::vector<Offset> effective_sizes(num_buffers, 0);
+  std::vector<Blocked> blocked;
+  for (const PreorderData& preorder_data : preordering) {
+    const BufferIdx buffer_idx = preorder_data.buffer_idx;
+    if (solution.offsets[buffer_idx] != kNoOffset) continue;
+    const BufferData& buffer_data = sweep_result.buffer_data[buffer_idx];
+    for (const Overlap& overlap : buffer_data.overlaps) {
+      effective_sizes[overlap.buffer_idx] = overlap.effective_size;
+    }
+    blocked.clear();
+    for (const auto& [other_idx, height] : placed[buffer_idx]) {
+      const Offset other_offset = solution.offsets[other_idx];
+      blocked.push_back({.lower = other_offset - effective_sizes[other_idx] + 1,
+                         .upper = height});
+    }
+    for (const Overlap& overlap : buffer_data.overlaps) {
+      effective_sizes[overlap.buffer_idx] = 0;
+    }
+    absl::c_sort(blocked, [](const Blocked& a, const Blocked& b) {
+      return a.lower < b.lower;
+    });
+    const Offset alignment = problem.buffers[buffer_idx].alignment;
+    Offset offset = 0;
+    for (const Blocked& range : blocked) {
+      if (offset < range.lower) break;
+      if (offset < range.upper) offset = Align(range.upper, alignment);
+    }
+    place(buffer_idx, offset);
+    std::vector<Placed>().swap(placed[buffer_idx]);
+  }
+  return solution;
+}
+
+Solution PlaceOnSkyline(const Problem& problem, const SweepResult& sweep_result,
+                        const std::vector<PreorderData>& preordering) {
+  const auto num_buffers = problem.buffers.size();
+  Solution solution;
+  solution.offsets.resize(num_buffers, kNoOffset);
+  std::vector<Offset> min_offsets(num_buffers, 0);
+  const auto place = [&](BufferIdx buffer_idx, Offset offset) {
+    solution.offsets[buffer_idx] = offset;
+    const BufferData& buffer_data = sweep_result.buffer_data[buffer_idx];
+    for (const Overlap& overlap : buffer_data.overlaps) {
+      const BufferIdx other_idx = overlap.buffer_idx;
+      if (solution.offsets[other_idx] != kNoOffset) continue;
+      const Offset height = Align(offset + overlap.effective_size,
+                                  problem.buffers[other_idx].alignment);
+      min_offsets[other_idx] = std::max(min_offsets[other_idx], height);
+    }
+  };
+  for (const PreorderData& preorder_data : preordering) {
+    const Buffer& buffer = problem.buffers[preorder_data.buffer_idx];
+    if (buffer.offset) place(preorder_data.buffer_idx, *buffer.offset);
+  }
+  // Entries (of minimum offset & position in the preordering) are left in the
+  // queue when minimum offsets rise, and are skipped (in favor of a new entry)
+  // once they're found to be stale.
+  using Entry = std::pair<Offset, int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  for (int preorder_idx = 0; preorder_idx < num_buffers; ++preorder_idx) {
+    const BufferIdx buffer_idx = preordering[preorder_idx].buffer_idx;
+    if (solution.offsets[buffer_idx] != kNoOffset) continue;
+    queue.push({0, preorder_idx});
+  }
+  while (!queue.empty()) {
+    const auto [offset, preorder_idx] = queue.top();
+    queue.pop();
+    const BufferIdx buffer_idx = preordering[preorder_idx].buffer_idx;
+    if (offset != min_offsets[buffer_idx]) {
+      queue.push({min_offsets[buffer_idx], preorder_idx});
+      continue;
+    }
+    place(buffer_idx, offset);
+  }
+  return solution;
+}
+
+}  // namespace minimalloc
@@ -0,0 +1,83 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef MINIMALLOC_SRC_PLACEMENT_H_
+#define MINIMALLOC_SRC_PLACEMENT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "minimalloc.h"
+#include "sweeper.h"
+
+namespace minimalloc {
+
+using PreorderingHeuristic = std::string;
+
+// Data used to help establish a static preordering of buffers.
+struct PreorderData {
+  Area area;  // The total area (i.e., space x time) consumed by this buffer.
+  TimeValue lower;  // When does the buffer start?
+  uint64_t overlaps;  // The number of pairwise overlaps with other buffers.
+  int sections;  // The number of sections spanned by this buffer.
+  int64_t size;  // The size of the buffer.
+  int total;  // The (maximum) total sum in any of this buffer's sections.
+  TimeValue upper;  // When does the buffer end?
+  int64_t width;  // The width of this buffer's lifespan.
+  uint64_t rank = 0;  // Breaks ties randomly (zero unless restarts are random).
+  BufferIdx buffer_idx;  // An index into a Problem's list of buffers.
+};
+
+class PreorderingComparator {
+ public:
+  explicit PreorderingComparator(const PreorderingHeuristic& h);
+  bool operator()(const PreorderData& a, const PreorderData& b) const;
+
+ private:
+  PreorderingHeuristic preordering_heuristic_;
+};
+
+// Computes the data used to preorder a buffer, given the current totals of the
+// sections (i.e., the sum of the unallocated buffer sizes in each).
+PreorderData CalcPreorderData(const Problem& problem,
+                              const SweepResult& sweep_result,
+                              const std::vector<Offset>& section_totals,
+                              BufferIdx buffer_idx, uint64_t rank);
+
+// Computes the data used to preorder each buffer of a problem (prior to any
+// allocation), in order of buffer index.
+std::vector<PreorderData> CalcPreordering(const Problem& problem,
+                                          const SweepResult& sweep_result);
+
+// Places each buffer (in the given order) at the lowest aligned offset where it
+// fits alongside the overlapping buffers placed before it, which may fall into
+// a hole beneath them.  Buffers with fixed offsets are placed beforehand.  The
+// resulting solution may exceed the problem's capacity.
+Solution PlaceFirstFit(const Problem& problem, const SweepResult& sweep_result,
+                       const std::vector<PreorderData>& preordering);
+
+// Repeatedly places the unallocated buffer with the lowest minimum offset (atop
+// the "skyline" of overlapping buffers placed so far), breaking ties using the
+// given order.  This follows the first branch of the Solver's search all the
+// way down.  Buffers with fixed offsets are placed beforehand.  The resulting
+// solution may exceed the problem's capacity.
+Solution PlaceOnSkyline(const Problem& problem, const SweepResult& sweep_result,
+                        const std::vector<PreorderData>& preordering);
+
+}  // namespace minimalloc
+
+#endif  // MINIMALLOC_SRC_PLACEMENT_H_
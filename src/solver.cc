@@ -20,19 +20,29 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <random>
 #include <vector>
 
 #include "absl/algorithm/container.h"
-#include "absl/container/flat_hash_set.h"
+#include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "minimalloc.h"
+#include "placement.h"
 #include "sweeper.h"
+#include "thread_pool.h"
 
 namespace minimalloc {
 namespace {
@@ -41,11 +51,17 @@ using PreorderIdx = int;  // An index into a preordered buffer list.
 
 constexpr int kNoOffset = -1;
 
-// Used to incrementally maintain data about sections during search.
-struct SectionData {
-  Offset floor = 0;  // The lowest viable offset for any buffer in this section.
-  int total = 0;  // A sum of the total unallocated buffer sizes in the section.
-};
+// Partitions with fewer buffers than this aren't worth searching in parallel,
+// nor (if produced by a dynamic decomposition) solving concurrently.
+constexpr int kMinParallelSearchBuffers = 16;
+
+// Partitions with fewer buffers than this are cheaper to re-sort at each search
+// node than to maintain in an order index.
+constexpr int kMinIndexedBuffers = 128;
+
+// Partitions spanning fewer sections than this are cheaper to scan in full at
+// each check than to query from a section tree.
+constexpr SectionIdx kMinTreeSections = 512;
 
 // Data used to help establish a dynamic ordering of buffers.
 struct OrderData {
@@ -65,6 +81,290 @@ struct SectionChange {
   Offset floor;
 };
 
+// The number of sections that Check examines between early exits; within each
+// block, sections are examined without branching so the loop can vectorize.
+constexpr SectionIdx kSectionBlock = 16;
+
+// Returns 'true' if any of the given sections would exceed capacity, i.e., if
+// max(offset, floor) + total is above it (or if section inference is disabled,
+// max(offset, floor) alone).
+template <bool kSectionInference>
+bool ExceedsCapacity(const Offset* floors, const Offset* totals,
+                     SectionIdx num_sections, Offset offset,
+                     Capacity capacity) {
+  SectionIdx s_idx = 0;
+  for (; s_idx + kSectionBlock <= num_sections; s_idx += kSectionBlock) {
+    bool exceeds = false;
+    for (SectionIdx idx = s_idx; idx < s_idx + kSectionBlock; ++idx) {
+      Offset height = std::max(offset, floors[idx]);
+      if constexpr (kSectionInference) height += totals[idx];
+      exceeds |= height > capacity;
+    }
+    if (exceeds) return true;
+  }
+  for (; s_idx < num_sections; ++s_idx) {
+    Offset height = std::max(offset, floors[s_idx]);
+    if constexpr (kSectionInference) height += totals[s_idx];
+    if (height > capacity) return true;
+  }
+  return false;
+}
+
+// Adds the given amount to the values of every section within a range.
+void AddToSections(std::vector<Offset>& values, const SectionRange& range,
+                   Offset amount) {
+  Offset* data = values.data();
+  for (SectionIdx s_idx = range.lower(); s_idx < range.upper(); ++s_idx) {
+    data[s_idx] += amount;
+  }
+}
+
+// A segment tree over a range of sections (e.g., those of a partition) that
+// maintains the maximum floor, total, and floor + total within any range of
+// them, under range assignment of floors and range addition of totals.  Each
+// modified tree node is recorded on a trail, so that changes can be rolled
+// back (in reverse order) cheaply.
+class SectionTree {
+ public:
+  struct Maxima {
+    Offset floor = 0;
+    Offset total = 0;
+    Offset floor_total = 0;
+  };
+
+  SectionTree() = default;
+
+  // Builds a tree over the given range of sections, whose floors and totals are
+  // found at the same indices of the given vectors.
+  SectionTree(const SectionRange& range, const std::vector<Offset>& floors,
+              const std::vector<Offset>& totals)
+      : base_(range.lower()), num_sections_(range.upper() - range.lower()),
+        nodes_(4 * num_sections_) {
+    if (num_sections_ > 0) Build(1, 0, num_sections_, floors, totals);
+  }
+
+  void AssignFloors(const SectionRange& range, Offset floor) {
+    Update(1, 0, num_sections_, Shift(range), floor, /*amount=*/0);
+  }
+
+  void AddToTotals(const SectionRange& range, Offset amount) {
+    Update(1, 0, num_sections_, Shift(range), kNoFloor, amount);
+  }
+
+  Maxima Query(const SectionRange& range) const {
+    return Query(1, 0, num_sections_, Shift(range), kNoFloor, /*amount=*/0);
+  }
+
+  size_t trail_size() const { return trail_.size(); }
+
+  // Returns a copy of this tree whose trail starts out empty.
+  SectionTree WithoutTrail() const {
+    SectionTree tree;
+    tree.base_ = base_;
+    tree.num_sections_ = num_sections_;
+    tree.nodes_ = nodes_;
+    return tree;
+  }
+
+  // Reverts every change made since the trail was at the given size.
+  void Rollback(size_t trail_size) {
+    while (trail_.size() > trail_size) {
+      const auto& [idx, tree_node] = trail_.back();
+      nodes_[idx] = tree_node;
+      trail_.pop_back();
+    }
+  }
+
+ private:
+  static constexpr Offset kNoFloor = -1;
+  static constexpr Offset kNoMaximum = std::numeric_limits<Offset>::min();
+
+  struct TreeNode {
+    Maxima maxima;
+    Offset floor = kNoFloor;  // A pending assignment to floors in the subtree.
+    Offset amount = 0;  // A pending addition to totals in the subtree.
+  };
+
+  // Converts a range of sections into one relative to the tree's first section.
+  SectionRange Shift(const SectionRange& range) const {
+    return {range.lower() - base_, range.upper() - base_};
+  }
+
+  void Build(int idx, SectionIdx lower, SectionIdx upper,
+             const std::vector<Offset>& floors,
+             const std::vector<Offset>& totals) {
+    if (upper - lower == 1) {
+      const Offset floor = floors[base_ + lower];
+      const Offset total = totals[base_ + lower];
+      nodes_[idx].maxima = {.floor = floor, .total = total,
+                            .floor_total = floor + total};
+      return;
+    }
+    const SectionIdx mid = (lower + upper) / 2;
+    Build(2 * idx, lower, mid, floors, totals);
+    Build(2 * idx + 1, mid, upper, floors, totals);
+    Pull(idx);
+  }
+
+  // Applies an assignment (unless kNoFloor) and addition to a whole subtree.
+  void Apply(int idx, Offset floor, Offset amount) {
+    TreeNode& tree_node = nodes_[idx];
+    trail_.push_back({idx, tree_node});
+    Maxima& maxima = tree_node.maxima;
+    maxima.total += amount;
+    maxima.floor_total += amount;
+    tree_node.amount += amount;
+    if (floor != kNoFloor) {
+      maxima.floor = floor;
+      maxima.floor_total = floor + maxima.total;
+      tree_node.floor = floor;
+    }
+  }
+
+  void Pull(int idx) {
+    const Maxima& left = nodes_[2 * idx].maxima;
+    const Maxima& right = nodes_[2 * idx + 1].maxima;
+    nodes_[idx].maxima = {
+        .floor = std::max(left.floor, right.floor),
+        .total = std::max(left.total, right.total),
+        .floor_total = std::max(left.floor_total, right.floor_total)};
+  }
+
+  void Update(int idx, SectionIdx lower, SectionIdx upper,
+              const SectionRange& range, Offset floor, Offset amount) {
+    if (range.upper() <= lower || upper <= range.lower()) return;
+    if (range.lower() <= lower && upper <= range.upper()) {
+      Apply(idx, floor, amount);
+      return;
+    }
+    // Hand any pending changes down to the children before modifying them.
+    TreeNode& tree_node = nodes_[idx];
+    trail_.push_back({idx, tree_node});
+    if (tree_node.floor != kNoFloor || tree_node.amount != 0) {
+      Apply(2 * idx, tree_node.floor, tree_node.amount);
+      Apply(2 * idx + 1, tree_node.floor, tree_node.amount);
+      tree_node.floor = kNoFloor;
+      tree_node.amount = 0;
+    }
+    const SectionIdx mid = (lower + upper) / 2;
+    Update(2 * idx, lower, mid, range, floor, amount);
+    Update(2 * idx + 1, mid, upper, range, floor, amount);
+    Pull(idx);
+  }
+
+  // Rather than handing pending changes down, queries carry them along: any
+  // assignment further up the tree is more recent than those below it.
+  Maxima Query(int idx, SectionIdx lower, SectionIdx upper,
+               const SectionRange& range, Offset floor, Offset amount) const {
+    if (range.upper() <= lower || upper <= range.lower()) {
+      return {kNoMaximum, kNoMaximum, kNoMaximum};
+    }
+    const TreeNode& tree_node = nodes_[idx];
+    if (range.lower() <= lower && upper <= range.upper()) {
+      Maxima maxima = tree_node.maxima;
+      maxima.total += amount;
+      maxima.floor_total += amount;
+      if (floor != kNoFloor) {
+        maxima.floor = floor;
+        maxima.floor_total = floor + maxima.total;
+      }
+      return maxima;
+    }
+    if (floor == kNoFloor) floor = tree_node.floor;
+    amount += tree_node.amount;
+    const SectionIdx mid = (lower + upper) / 2;
+    const Maxima left = Query(2 * idx, lower, mid, range, floor, amount);
+    const Maxima right = Query(2 * idx + 1, mid, upper, range, floor, amount);
+    return {.floor = std::max(left.floor, right.floor),
+            .total = std::max(left.total, right.total),
+            .floor_total = std::max(left.floor_total, right.floor_total)};
+  }
+
+  SectionIdx base_ = 0;  // The first section covered by the tree.
+  SectionIdx num_sections_ = 0;
+  std::vector<TreeNode> nodes_;
+  std::vector<std::pair<int, TreeNode>> trail_;
+};
+
+// Signals that a search (along with any search nested within it) should end,
+// e.g., because some concurrent search has already decided the outcome.
+struct StopFlag {
+  bool IsSet() const {
+    for (const StopFlag* flag = this; flag; flag = flag->parent) {
+      if (flag->stopped) return true;
+    }
+    return false;
+  }
+  std::atomic<bool> stopped = false;
+  const StopFlag* parent = nullptr;  // The flag of any enclosing search.
+};
+
+// A buffer placement made along the path from the root of the search tree.
+struct Decision {
+  BufferIdx buffer_idx;
+  Offset offset;
+};
+
+// A search node whose remaining children may be claimed by any worker.
+struct Frame {
+  int depth = 0;  // The number of decisions leading up to this node.
+  const std::vector<OrderData>* ordering = nullptr;
+  Offset min_offset = 0;
+  PreorderIdx min_preorder_idx = 0;
+  Offset min_height = 0;
+  std::atomic<int> next_idx = 0;  // The next child (in ordering) to be claimed.
+};
+
+// A child of some node (stolen from another worker), which may be explored once
+// the path leading to its parent has been replayed.
+struct Task {
+  std::vector<Decision> path;
+  std::vector<OrderData> ordering;
+  Offset min_offset = 0;
+  PreorderIdx min_preorder_idx = 0;
+  Offset min_height = 0;
+  int child_idx = 0;
+};
+
+// The portion of a worker's state that is visible to would-be thieves.
+struct Worker {
+  std::mutex mutex;
+  std::vector<Decision> path;  // Decisions leading to the current node.
+  std::vector<Frame*> frames;  // Open nodes, from shallowest to deepest.
+  std::vector<Frame> frame_pool;  // Storage for open nodes, one per depth.
+};
+
+// State shared by the workers that cooperatively search a single partition.
+struct Team {
+  Team(int num_workers, int max_depth, const StopFlag* parent)
+      : workers(num_workers) {
+    for (Worker& worker : workers) {
+      worker.frame_pool = std::vector<Frame>(max_depth);
+    }
+    stop.parent = parent;
+  }
+  std::vector<Worker> workers;
+  std::atomic<int> busy = 0;  // The number of workers exploring some branch.
+  StopFlag stop;  // Set once the search has concluded.
+  std::mutex mutex;
+  // Signalled whenever there may be something new to steal, or once nobody is
+  // busy (or the search has concluded).
+  std::condition_variable cv;
+  std::atomic<int> idle = 0;  // The number of workers waiting on 'cv'.
+  std::optional<absl::StatusCode> status_code;  // The first conclusive result.
+  Solution solution;  // The offsets found by whichever worker succeeded.
+};
+
+// A (sub-)partition to be searched, along with its static preordering and the
+// initial ordering of its buffers.
+struct Context {
+  Partition partition;
+  const PreorderingComparator* preordering_comparator = nullptr;
+  std::vector<PreorderData> preordering;
+  std::vector<OrderData> ordering;
+  std::vector<OrderData> fixed;  // Buffers w/ fixed offsets (in dynamic order).
+};
+
 // Dynamically orders buffers by minimum offset, followed by preorder index.
 const auto kDynamicComparator =
     [](const OrderData& a, const OrderData& b) {
@@ -72,13 +372,132 @@ const auto kDynamicComparator =
       return a.preorder_idx < b.preorder_idx;
     };
 
+// The unallocated buffers of the (sub-)partition being searched, which are kept
+// in dynamic order as their minimum offsets change (and are rolled back along
+// with the offset trail), so that search nodes needn't re-sort them.
+struct OrderIndex {
+  using Ordering = absl::btree_set<OrderData, decltype(kDynamicComparator)>;
+  bool enabled = false;  // If unset, the partition is re-sorted at each node.
+  Ordering ordering;
+  // The preorder indices that this partition's buffers had beforehand (i.e., in
+  // any enclosing partition), to be reinstated once it has been searched.
+  std::vector<PreorderIdx> prev_preorder_idxs;
+};
+
+// The outcomes of sub-partitions that have been searched to completion, keyed
+// by everything that determines such an outcome: the sub-partition's section
+// range and buffers, their minimum offsets, and the floors of its sections.
+// Infeasible sub-partitions are recorded as nogoods, and feasible ones along
+// with their offsets.  A table may be shared by several solvers (e.g., forks),
+// and is cleared whenever a new entry would exceed its memory budget.
+class TranspositionTable {
+ public:
+  explicit TranspositionTable(int64_t max_bytes) : max_bytes_(max_bytes) {}
+
+  // Returns the recorded outcome for a key (if any), copying the offsets of a
+  // feasible sub-partition into 'offsets'.
+  std::optional<absl::StatusCode> Lookup(const std::vector<int64_t>& key,
+                                         std::vector<Offset>& offsets) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = entries_.find(key);
+    if (it == entries_.end()) return std::nullopt;
+    offsets = it->second.offsets;
+    return it->second.status_code;
+  }
+
+  void Insert(std::vector<int64_t> key, absl::StatusCode status_code,
+              std::vector<Offset> offsets) {
+    const int64_t bytes = sizeof(key) + sizeof(Entry) +
+        (key.size() + offsets.size()) * sizeof(int64_t);
+    if (bytes > max_bytes_) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bytes_ + bytes > max_bytes_) {
+      entries_.clear();
+      bytes_ = 0;
+    }
+    Entry entry = {.status_code = status_code, .offsets = std::move(offsets)};
+    if (entries_.try_emplace(std::move(key), std::move(entry)).second) {
+      bytes_ += bytes;
+    }
+  }
+
+ private:
+  struct Entry {
+    absl::StatusCode status_code;
+    std::vector<Offset> offsets;  // Parallel to the sub-partition's buffers.
+  };
+
+  const int64_t max_bytes_;
+  std::mutex mutex_;
+  absl::flat_hash_map<std::vector<int64_t>, Entry> entries_;
+  int64_t bytes_ = 0;  // The approximate memory consumed by the entries.
+};
+
+// An entry on the explicit stack that stands in for recursion during search.
+// Search nodes place each of their candidate buffers in turn, whereas
+// decomposition nodes solve the sub-partitions that a placement splits off.
+struct Node {
+  enum Kind { kSearch, kDecompose };
+  Kind kind = kSearch;
+  const Context* context = nullptr;
+  // For search nodes, the candidates to be placed (or null if these are drawn
+  // from the order index instead); for decomposition nodes, the ordering to pass
+  // along if the placement didn't split the partition.
+  const std::vector<OrderData>* ordering = nullptr;
+  Offset min_offset = 0;
+  PreorderIdx min_preorder_idx = 0;
+  Offset min_height = 0;
+  // The first of the context's buffers with fixed offsets that is unallocated
+  // (or beyond the end of them, if all are allocated).
+  int fixed_idx = 0;
+  int next_idx = 0;  // The next candidate to be explored.
+  int end_idx = 0;
+  OrderData order_data;  // The candidate currently being explored.
+  // The position of that candidate within the order index (if drawn from it),
+  // which remains valid for as long as the index is left unmodified.
+  OrderIndex::Ordering::const_iterator cursor;
+  bool lone_branch = false;  // Set if exploring a single (stolen) candidate.
+  Frame* frame = nullptr;  // Non-null if other workers may claim candidates.
+  // The placement currently being explored (or for decomposition nodes, the
+  // placement that was just made).
+  BufferIdx buffer_idx = 0;
+  size_t offset_trail_size = 0;
+  size_t section_trail_size = 0;
+  size_t tree_trail_size = 0;
+  bool hatless = false;
+  bool shared_path = false;
+  bool indexed = false;  // Set if the order index reflects this placement.
+  bool reindexed = false;  // Set if the order index has since been modified.
+  // The cutpoints of a decomposition node, and the sub-partition being solved.
+  bool split = false;
+  size_t cutpoints_begin = 0;
+  size_t cutpoints_end = 0;
+  size_t cutpoint_idx = 0;
+};
+
+// Returns the i-th term (starting from one) of the Luby sequence, i.e., 1, 1,
+// 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...
+int64_t Luby(int64_t i) {
+  while (true) {
+    int64_t power = 1;  // The smallest 2^k such that 2^k - 1 >= i.
+    while (power - 1 < i) power *= 2;
+    if (power - 1 == i) return power / 2;
+    i -= power / 2 - 1;
+  }
+}
+
 class SolverImpl {
  public:
   SolverImpl(const SolverParams& params, const absl::Time start_time,
       const Problem& problem, const SweepResult& sweep_result,
-      int64_t* backtracks, std::atomic<bool>& cancelled) : params_(params),
-      start_time_(start_time), problem_(problem), sweep_result_(sweep_result),
-      backtracks_(*backtracks), cancelled_(cancelled) {}
+      int64_t* backtracks, std::atomic<bool>& cancelled, ThreadPool* pool,
+      const StopFlag* stop = nullptr)
+      : params_(params), start_time_(start_time), problem_(problem),
+        sweep_result_(sweep_result), backtracks_(backtracks),
+        cancelled_(cancelled),
+        pool_(params.partition_threads > 1 ? pool : nullptr),
+        search_pool_(params.search_threads > 1 ? pool : nullptr),
+        stop_(stop) {}
 
   absl::StatusOr<Solution> Solve() {
     if (problem_.buffers.empty()) return solution_;
@@ -86,24 +505,51 @@ class SolverImpl {
     assignment_.offsets.resize(num_buffers, kNoOffset);
     solution_.offsets.resize(num_buffers, kNoOffset);
     min_offsets_.resize(num_buffers);
-    section_data_.resize(sweep_result_.sections.size());
+    preorder_idxs_.resize(num_buffers);
+    section_floors_.resize(sweep_result_.sections.size());
+    section_totals_.resize(sweep_result_.sections.size());
     for (BufferIdx buffer_idx = 0; buffer_idx < num_buffers; ++buffer_idx) {
       const BufferData& buffer_data = sweep_result_.buffer_data[buffer_idx];
       for (const SectionSpan& section_span : buffer_data.section_spans) {
-        const SectionRange& section_range = section_span.section_range;
         const Window& window = section_span.window;
-        for (SectionIdx s_idx = section_range.lower();
-            s_idx < section_range.upper(); ++s_idx) {
-          section_data_[s_idx].total += window.upper() - window.lower();
-        }
+        AddToSections(section_totals_, section_span.section_range,
+                      window.upper() - window.lower());
       }
       if (const Buffer& buffer = problem_.buffers[buffer_idx]; buffer.offset) {
         min_offsets_[buffer_idx] = *buffer.offset;
       }
     }
     cuts_ = sweep_result_.CalculateCuts();
+    // Each level of search places one buffer, so this bounds its depth.
+    orderings_.resize(num_buffers + 1);
+    stack_.reserve(2 * (num_buffers + 1));
+    section_marks_.resize(sweep_result_.sections.size());
+    hint_first_ = params_.hint_first &&
+        absl::c_any_of(problem_.buffers,
+                       [](const Buffer& buffer) { return buffer.hint; });
+    if (params_.dynamic_decomposition && params_.transposition_bytes > 0) {
+      transpositions_ =
+          std::make_shared<TranspositionTable>(params_.transposition_bytes);
+    }
+    if (params_.randomized_restarts) {
+      absl::Status status = Restart(sweep_result_.partitions);
+      if (!status.ok()) return status;
+      return solution_;
+    }
+    if (pool_ && sweep_result_.partitions.size() > 1) {
+      absl::Status status = SolveConcurrently(sweep_result_.partitions,
+          [](SolverImpl& solver, const Partition& partition) {
+            return solver.SolvePartition(partition);
+          });
+      if (!status.ok()) return status;
+      return solution_;
+    }
     // If multiple heuristics were specified, use round robin to try them all.
-    if (params_.preordering_heuristics.size() > 1) return RoundRobin();
+    if (params_.preordering_heuristics.size() > 1) {
+      absl::Status status = RoundRobin(sweep_result_.partitions);
+      if (!status.ok()) return status;
+      return solution_;
+    }
     PreorderingComparator preordering_comparator(
         params_.preordering_heuristics.back());
     for (const Partition& partition : sweep_result_.partitions) {
@@ -114,7 +560,18 @@ class SolverImpl {
   }
 
  private:
-  absl::StatusOr<Solution> RoundRobin() {
+  // Solves a single partition, using round robin if multiple heuristics were
+  // specified.
+  absl::Status SolvePartition(const Partition& partition) {
+    if (params_.preordering_heuristics.size() > 1) {
+      return RoundRobin(absl::MakeConstSpan(&partition, 1));
+    }
+    PreorderingComparator preordering_comparator(
+        params_.preordering_heuristics.back());
+    return SubSolve(partition, preordering_comparator);
+  }
+
+  absl::Status RoundRobin(absl::Span<const Partition> partitions) {
     // We'll start with a conservative node limit (in the hopes that one of
     // them will finish quickly), then progressively increase this threshold.
     int64_t node_limit = problem_.buffers.size();
@@ -125,7 +582,7 @@ class SolverImpl {
         PreorderingComparator preordering_comparator(heuristic);
         nodes_remaining_ = node_limit;
         status = absl::OkStatus();
-        for (const Partition& partition : sweep_result_.partitions) {
+        for (const Partition& partition : partitions) {
           status = SubSolve(partition, preordering_comparator);
           // The 'aborted' code means this strategy exhausted its node limit.
           if (status.code() == absl::StatusCode::kAborted) break;
@@ -135,119 +592,302 @@ class SolverImpl {
       }
       if (status.ok()) break;
     }
-    return solution_;
+    return absl::OkStatus();
   }
 
-  // Prepopulates section data for this partition, then kicks into the recursive
-  // depth-first search.  Returns 'true' if a feasible solution has been found,
-  // otherwise 'false'.
-  absl::Status SubSolve(
-      const Partition& partition,
+  // Searches the partitions under a geometric (or Luby) schedule of node limits,
+  // trying every heuristic at each limit (as in round robin).  After the first
+  // round, ties in the preordering (and hence in the dynamic ordering) are
+  // broken randomly, so that restarts needn't wander back into the same
+  // unpromising subtrees.  Partitions that have been solved are kept.
+  absl::Status Restart(const std::vector<Partition>& partitions) {
+    std::mt19937_64 rng(params_.seed);
+    std::vector<Partition> unsolved = partitions;
+    for (int64_t restart = 1;; ++restart) {
+      // The first limit matches the first one used by round robin.
+      const int64_t multiplier = params_.luby_restarts
+          ? Luby(restart) : int64_t{1} << std::min<int64_t>(restart - 1, 32);
+      const int64_t node_limit = multiplier * 2 * problem_.buffers.size();
+      for (const auto& heuristic : params_.preordering_heuristics) {
+        PreorderingComparator preordering_comparator(heuristic);
+        nodes_remaining_ = node_limit;
+        absl::Status status = SolveUnsolved(unsolved, preordering_comparator);
+        if (!status.ok()) return status;
+        if (unsolved.empty()) return absl::OkStatus();
+      }
+      ranks_.resize(problem_.buffers.size());
+      for (uint64_t& rank : ranks_) rank = rng();
+    }
+  }
+
+  // Solves as many of the given partitions as possible (concurrently if a
+  // thread pool was provided) before the node limit is exhausted, removing
+  // those that are solved.  Returns a status if any partition couldn't be.
+  absl::Status SolveUnsolved(
+      std::vector<Partition>& unsolved,
       const PreorderingComparator& preordering_comparator) {
-    std::vector<PreorderData> preordering;
-    preordering.reserve(partition.buffer_idxs.size());
-    for (const BufferIdx buffer_idx : partition.buffer_idxs) {
-      const Buffer& buffer = problem_.buffers[buffer_idx];
-      int total = 0;
-      const BufferData& buffer_data = sweep_result_.buffer_data[buffer_idx];
-      const std::vector<SectionSpan>& section_spans = buffer_data.section_spans;
-      for (const SectionSpan& section_span : section_spans) {
-        const SectionRange& section_range = section_span.section_range;
-        for (SectionIdx s_idx = section_range.lower();
-            s_idx < section_range.upper(); ++s_idx) {
-          total = std::max(total, section_data_[s_idx].total);
+    // Partitions that aren't attempted remain unsolved.
+    std::vector<absl::Status> statuses(unsolved.size(),
+                                       absl::AbortedError("Not attempted."));
+    if (pool_ && unsolved.size() > 1) {
+      // An abort merely ends this attempt, so it needn't abandon the others.
+      const absl::Status status = SolveConcurrently(unsolved,
+          [&](SolverImpl& solver, const Partition& partition) {
+            absl::Status status =
+                solver.SubSolve(partition, preordering_comparator);
+            statuses[&partition - unsolved.data()] = status;
+            return absl::IsAborted(status) ? absl::OkStatus() : status;
+          });
+      if (!status.ok()) return status;
+    } else {
+      for (int idx = 0; idx < unsolved.size(); ++idx) {
+        statuses[idx] = SubSolve(unsolved[idx], preordering_comparator);
+        if (absl::IsAborted(statuses[idx])) break;
+        if (!statuses[idx].ok()) return statuses[idx];
+      }
+    }
+    std::vector<Partition> remaining;
+    for (int idx = 0; idx < unsolved.size(); ++idx) {
+      if (!statuses[idx].ok()) remaining.push_back(std::move(unsolved[idx]));
+    }
+    unsolved = std::move(remaining);
+    return absl::OkStatus();
+  }
+
+  // Returns a new solver that starts from our current search state (but none
+  // of the nodes, trails, or scratch space leading up to it), which may be used
+  // by another thread, and which is abandoned once 'stop' is set.
+  std::unique_ptr<SolverImpl> Fork(const StopFlag* stop) const {
+    auto fork = std::make_unique<SolverImpl>(params_, start_time_, problem_,
+        sweep_result_, /*backtracks=*/nullptr, cancelled_, /*pool=*/nullptr);
+    fork->backtracks_ = &fork->fork_backtracks_;
+    fork->pool_ = pool_;
+    fork->search_pool_ = search_pool_;
+    fork->assignment_ = assignment_;
+    fork->solution_ = solution_;
+    fork->min_offsets_ = min_offsets_;
+    fork->preorder_idxs_ = preorder_idxs_;
+    fork->section_floors_ = section_floors_;
+    fork->section_totals_ = section_totals_;
+    if (section_tree_) fork->section_tree_ = section_tree_->WithoutTrail();
+    fork->cuts_ = cuts_;
+    fork->nodes_remaining_ = nodes_remaining_;
+    fork->nesting_ = nesting_;
+    fork->hint_first_ = hint_first_;
+    fork->depth_ = depth_;
+    fork->orderings_.resize(orderings_.size());
+    fork->section_marks_.resize(section_marks_.size());
+    fork->stack_.reserve(stack_.capacity());
+    fork->stop_ = stop;
+    fork->transpositions_ = transpositions_;
+    fork->ranks_ = ranks_;
+    return fork;
+  }
+
+  // Solves several independent (sub-)partitions concurrently using the thread
+  // pool, storing their offsets into our solution.  The first is solved by this
+  // solver, and the rest by whichever solver is idle (since a search always
+  // restores the state it began with), or else by a new fork of it.  If any
+  // partition cannot be solved, the remaining ones are abandoned.
+  absl::Status SolveConcurrently(
+      const std::vector<Partition>& partitions,
+      const std::function<absl::Status(SolverImpl&, const Partition&)>& solve) {
+    const StopFlag* outer_stop = stop_;
+    StopFlag stop;
+    stop.parent = outer_stop;
+    // Our state prior to any search (without the nodes and trails leading up to
+    // it), from which forks are made while we're busy searching.
+    const std::unique_ptr<SolverImpl> prototype = Fork(&stop);
+    std::mutex mutex;
+    std::vector<std::unique_ptr<SolverImpl>> forks;
+    std::vector<SolverImpl*> idle_forks;  // Solvers awaiting another partition.
+    std::vector<SolverImpl*> solvers(partitions.size(), nullptr);
+    absl::Status result = absl::OkStatus();  // The first failure (if any).
+    stop_ = &stop;
+    const auto record = [&](const absl::Status& status) {
+      if (status.ok() || !result.ok()) return;
+      result = status;
+      stop.stopped = true;
+    };
+    pool_->ParallelFor(partitions.size(), [&](int idx) {
+      if (stop.IsSet()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        record(absl::DeadlineExceededError("Search abandoned."));
+        return;
+      }
+      SolverImpl* solver = idx == 0 ? this : nullptr;
+      if (!solver) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idle_forks.empty()) {
+          solver = idle_forks.back();
+          idle_forks.pop_back();
         }
       }
-      int sections = section_spans.back().section_range.upper() -
-                     section_spans.front().section_range.lower();
-      preordering.push_back({
-        .area = buffer.area(),
-        .lower = buffer.lifespan.lower(),
-        .overlaps = buffer_data.overlaps.size(),
-        .sections = sections,
-        .size = buffer.size,
-        .total = total,
-        .upper = buffer.lifespan.upper(),
-        .width = buffer.lifespan.upper() - buffer.lifespan.lower(),
-        .buffer_idx = buffer_idx});
+      if (!solver) {
+        std::unique_ptr<SolverImpl> fork = prototype->Fork(&stop);
+        std::lock_guard<std::mutex> lock(mutex);
+        solver = forks.emplace_back(std::move(fork)).get();
+      }
+      absl::Status status = solve(*solver, partitions[idx]);
+      std::lock_guard<std::mutex> lock(mutex);
+      solvers[idx] = solver;
+      idle_forks.push_back(solver);  // Including us, once the first is solved.
+      record(status);
+    });
+    stop_ = outer_stop;
+    for (const std::unique_ptr<SolverImpl>& fork : forks) {
+      *backtracks_ += fork->fork_backtracks_;
+      nodes_remaining_ -= prototype->nodes_remaining_ - fork->nodes_remaining_;
+    }
+    if (!result.ok()) return result;
+    for (int idx = 1; idx < partitions.size(); ++idx) {
+      const Solution& solution = solvers[idx]->solution_;
+      for (const BufferIdx buffer_idx : partitions[idx].buffer_idxs) {
+        solution_.offsets[buffer_idx] = solution.offsets[buffer_idx];
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Computes the static preordering (and initial ordering) for a partition.
+  void PrepareContext(const PreorderingComparator& preordering_comparator,
+                      Context& context) {
+    const Partition& partition = context.partition;
+    context.preordering_comparator = &preordering_comparator;
+    std::vector<PreorderData>& preordering = context.preordering;
+    preordering.reserve(partition.buffer_idxs.size());
+    for (const BufferIdx buffer_idx : partition.buffer_idxs) {
+      preordering.push_back(CalcPreorderData(problem_, sweep_result_,
+          section_totals_, buffer_idx, ranks_.empty() ? 0 : ranks_[buffer_idx]));
     }
     if (params_.static_preordering) {
       absl::c_sort(preordering, preordering_comparator);
+    } else if (!ranks_.empty()) {
+      absl::c_sort(preordering,
+                   [](const PreorderData& a, const PreorderData& b) {
+                     return a.rank < b.rank;
+                   });
     }
-    std::vector<OrderData> ordering(preordering.size());
+    context.ordering.resize(preordering.size());
     for (PreorderIdx idx = 0; idx < preordering.size(); ++idx) {
-      ordering[idx].preorder_idx = idx;
+      context.ordering[idx].preorder_idx = idx;
+      const Buffer& buffer = problem_.buffers[preordering[idx].buffer_idx];
+      if (buffer.offset) {
+        context.fixed.push_back({.offset = *buffer.offset, .preorder_idx = idx});
+      }
+    }
+    absl::c_sort(context.fixed, kDynamicComparator);
+  }
+
+  // Prepopulates section data for this partition, then kicks into the depth-
+  // first search.  Returns 'true' if a feasible solution has been found,
+  // otherwise 'false'.
+  absl::Status SubSolve(
+      const Partition& partition,
+      const PreorderingComparator& preordering_comparator) {
+    Context& context = contexts_.emplace_back();
+    context.partition = partition;
+    PrepareContext(preordering_comparator, context);
+    const bool parallel = search_pool_ && nesting_ == 0 &&
+        partition.buffer_idxs.size() >= kMinParallelSearchBuffers;
+    PushOrderIndex(context, /*shared=*/parallel);
+    // Only a partition wide enough to query a section tree maintains one, which
+    // any sub-partitions found within it (however narrow) keep up to date.
+    const SectionRange& section_range = partition.section_range;
+    const bool owns_tree = !section_tree_ &&
+        section_range.upper() - section_range.lower() >= kMinTreeSections;
+    if (owns_tree) {
+      section_tree_.emplace(section_range, section_floors_, section_totals_);
     }
-    absl::StatusCode status_code =
-        SearchSolutions(partition, preordering_comparator, preordering,
-            ordering, /*min_offset=*/0, /*min_preorder_idx=*/0);
+    absl::StatusCode status_code = parallel
+        ? ParallelSearch(context)
+        : Search(context, &context.ordering, /*min_offset=*/0,
+                 /*min_preorder_idx=*/0);
+    if (owns_tree) section_tree_.reset();
+    PopOrderIndex(context);
+    contexts_.pop_back();
     return status_code == absl::StatusCode::kOk ? absl::OkStatus()
         : absl::Status(status_code, "Error encountered during search.");
   }
 
-  // Updates section data given that 'buffer_idx' is the next item to be placed.
-  std::vector<SectionChange> UpdateSectionData(
-      const absl::flat_hash_set<SectionIdx>& affected_sections,
-      BufferIdx buffer_idx) {
-    std::vector<SectionChange> section_changes;
+  // Updates section data given that 'buffer_idx' is the next item to be placed,
+  // recording the previous floors onto the section trail.
+  void UpdateSectionData(BufferIdx buffer_idx) {
     const Offset offset = assignment_.offsets[buffer_idx];
     // For any section this buffer resides in, bump up the floor & drop the sum.
     const BufferData& buffer_data = sweep_result_.buffer_data[buffer_idx];
     for (const SectionSpan& section_span : buffer_data.section_spans) {
       const SectionRange& section_range = section_span.section_range;
       const Window& window = section_span.window;
-      const Offset height = offset + window.upper();
+      const size_t trail_size = section_trail_.size();
+      section_trail_.resize(trail_size + section_range.upper() -
+                            section_range.lower());
+      SectionChange* section_changes = section_trail_.data() + trail_size;
       for (SectionIdx s_idx = section_range.lower();
           s_idx < section_range.upper(); ++s_idx) {
-        section_changes.push_back(
-            {.section_idx = s_idx, .floor = section_data_[s_idx].floor});
-        section_data_[s_idx].floor = height;
-        section_data_[s_idx].total -= window.upper() - window.lower();
+        *section_changes++ = {.section_idx = s_idx,
+                              .floor = section_floors_[s_idx]};
+      }
+      std::fill(section_floors_.begin() + section_range.lower(),
+                section_floors_.begin() + section_range.upper(),
+                offset + window.upper());
+      AddToSections(section_totals_, section_range,
+                    window.lower() - window.upper());
+      if (section_tree_) {
+        section_tree_->AssignFloors(section_range, offset + window.upper());
+        section_tree_->AddToTotals(section_range,
+                                   window.lower() - window.upper());
       }
     }
     // The floor of any section cannot be lower than its lowest minimum offset.
-    for (const SectionIdx s_idx : affected_sections) {
+    for (const SectionIdx s_idx : affected_sections_) {
       Offset min_offset = INT_MAX;
       for (const BufferIdx other_idx : sweep_result_.sections[s_idx]) {
         if (assignment_.offsets[other_idx] == kNoOffset) {
           min_offset = std::min(min_offset, min_offsets_[other_idx]);
         }
       }
-      if (min_offset != INT_MAX && section_data_[s_idx].floor < min_offset) {
-        section_changes.push_back(
-            {.section_idx = s_idx, .floor = section_data_[s_idx].floor});
-        section_data_[s_idx].floor = min_offset;
+      if (min_offset != INT_MAX && section_floors_[s_idx] < min_offset) {
+        section_trail_.push_back(
+            {.section_idx = s_idx, .floor = section_floors_[s_idx]});
+        section_floors_[s_idx] = min_offset;
+        if (section_tree_) {
+          section_tree_->AssignFloors({s_idx, s_idx + 1}, min_offset);
+        }
       }
     }
-    return section_changes;
   }
 
-  // Restores the section data by reversing any recorded changes.
-  void RestoreSectionData(
-      const std::vector<SectionChange>& section_changes,
-      BufferIdx buffer_idx) {
-    for (auto c = section_changes.rbegin(); c != section_changes.rend(); ++c) {
-      section_data_[c->section_idx].floor = c->floor;
+  // Restores the section data by reversing any changes recorded on the section
+  // trail (and the section tree's trail) beyond the given sizes.
+  void RestoreSectionData(size_t trail_size, size_t tree_trail_size,
+                          BufferIdx buffer_idx) {
+    if (section_tree_) section_tree_->Rollback(tree_trail_size);
+    while (section_trail_.size() > trail_size) {
+      const SectionChange& section_change = section_trail_.back();
+      section_floors_[section_change.section_idx] = section_change.floor;
+      section_trail_.pop_back();
     }
     // For any section this buffer resides in, increase the sum.
     const BufferData& buffer_data = sweep_result_.buffer_data[buffer_idx];
     for (const SectionSpan& section_span : buffer_data.section_spans) {
-      const SectionRange& section_range = section_span.section_range;
       const Window& window = section_span.window;
-      for (SectionIdx s_idx = section_range.lower();
-          s_idx < section_range.upper(); ++s_idx) {
-        section_data_[s_idx].total += window.upper() - window.lower();
-      }
+      AddToSections(section_totals_, section_span.section_range,
+                    window.upper() - window.lower());
     }
   }
 
-  // Updates min offset data, given that 'buffer_idx' is the next to be placed.
-  std::optional<std::vector<OffsetChange>> UpdateMinOffsets(
-      BufferIdx buffer_idx,
-      absl::flat_hash_set<SectionIdx>& affected_sections,
-      bool& fixed_offset_failure) {
+  // Updates min offset data, given that 'buffer_idx' is the next to be placed,
+  // recording the previous values onto the offset trail (and collecting the
+  // sections whose floors may need to be raised).  Returns 'true' if no other
+  // unallocated buffer overlaps with this one (i.e., it is "hatless").
+  bool UpdateMinOffsets(BufferIdx buffer_idx, bool& fixed_offset_failure) {
     bool hatless = true;
-    std::vector<OffsetChange> offset_changes;
+    affected_sections_.clear();
+    if (++section_epoch_ == 0) {  // On wraparound, forget all previous marks.
+      absl::c_fill(section_marks_, 0);
+      section_epoch_ = 1;
+    }
     const Offset offset = assignment_.offsets[buffer_idx];
     // For any overlap this buffer participates in, bump up its minimum offset.
     const std::vector<BufferData>& buffer_data = sweep_result_.buffer_data;
@@ -257,7 +897,7 @@ class SolverImpl {
       hatless = false;
       const Offset height = offset + overlap.effective_size;
       if (min_offsets_[other_idx] >= height) continue;
-      offset_changes.push_back(
+      offset_trail_.push_back(
           {.buffer_idx = other_idx, .min_offset = min_offsets_[other_idx]});
       min_offsets_[other_idx] = height;
       const Buffer& other_buffer = problem_.buffers[other_idx];
@@ -273,43 +913,164 @@ class SolverImpl {
         const SectionRange& section_range = section_span.section_range;
         for (SectionIdx s_idx = section_range.lower();
              s_idx < section_range.upper(); ++s_idx) {
-          affected_sections.insert(s_idx);
+          if (section_marks_[s_idx] == section_epoch_) continue;
+          section_marks_[s_idx] = section_epoch_;
+          affected_sections_.push_back(s_idx);
         }
       }
     }
-    if (hatless) return std::nullopt;
-    return offset_changes;
+    return hatless;
+  }
+
+  // Restores the minimum offsets by reversing any changes recorded on the
+  // offset trail beyond the given size.
+  void RestoreMinOffsets(size_t trail_size) {
+    while (offset_trail_.size() > trail_size) {
+      const OffsetChange& offset_change = offset_trail_.back();
+      min_offsets_[offset_change.buffer_idx] = offset_change.min_offset;
+      offset_trail_.pop_back();
+    }
+  }
+
+  // Begins maintaining an order index for the given (sub-)partition, whose
+  // buffers must all be unallocated.  The index is only enabled if search nodes
+  // can draw their candidates from it directly, i.e., under dynamic ordering
+  // without hints, and if the partition's nodes aren't shared with other workers
+  // (who need these candidates written out).
+  void PushOrderIndex(const Context& context, bool shared) {
+    OrderIndex& index = indices_.emplace_back();
+    const std::vector<PreorderData>& preordering = context.preordering;
+    if (!params_.dynamic_ordering || hint_first_ || shared ||
+        preordering.size() < kMinIndexedBuffers) {
+      return;
+    }
+    index.enabled = true;
+    index.prev_preorder_idxs.reserve(preordering.size());
+    for (PreorderIdx preorder_idx = 0; preorder_idx < preordering.size();
+        ++preorder_idx) {
+      const BufferIdx buffer_idx = preordering[preorder_idx].buffer_idx;
+      index.prev_preorder_idxs.push_back(preorder_idxs_[buffer_idx]);
+      preorder_idxs_[buffer_idx] = preorder_idx;
+      AddToIndex(index, buffer_idx);
+    }
+  }
+
+  // Discards the order index of the given (sub-)partition, reinstating the
+  // preorder indices of any enclosing partition.
+  void PopOrderIndex(const Context& context) {
+    if (indices_.back().enabled) {
+      const std::vector<PreorderData>& preordering = context.preordering;
+      const std::vector<PreorderIdx>& prev_preorder_idxs =
+          indices_.back().prev_preorder_idxs;
+      for (PreorderIdx preorder_idx = 0; preorder_idx < preordering.size();
+          ++preorder_idx) {
+        preorder_idxs_[preordering[preorder_idx].buffer_idx] =
+            prev_preorder_idxs[preorder_idx];
+      }
+    }
+    indices_.pop_back();
+  }
+
+  // Returns the innermost partition's order index, or null if it isn't enabled.
+  OrderIndex* GetOrderIndex() {
+    if (indices_.empty() || !indices_.back().enabled) return nullptr;
+    return &indices_.back();
   }
 
-  // Restores the minimum offsets by reversing any recorded changes.
-  void RestoreMinOffsets(const std::vector<OffsetChange>& offset_changes) {
-    for (auto c = offset_changes.rbegin(); c != offset_changes.rend(); ++c) {
-      min_offsets_[c->buffer_idx] = c->min_offset;
+  // Brings the innermost order index (if any) up to date with the placement of
+  // a buffer, which had changed the minimum offsets recorded on the offset trail
+  // beyond the given size.  This is deferred until the placement passes its
+  // checks, since most placements are pruned right away.
+  void IndexPlacement(BufferIdx buffer_idx, size_t trail_size) {
+    OrderIndex* index = GetOrderIndex();
+    if (!index) return;
+    RemoveFromIndex(*index, buffer_idx);
+    for (size_t idx = trail_size; idx < offset_trail_.size(); ++idx) {
+      const auto [other_idx, prev_offset] = offset_trail_[idx];
+      Reindex(*index, other_idx, prev_offset, min_offsets_[other_idx]);
     }
   }
 
+  // Reverts the changes made to the innermost order index by IndexPlacement;
+  // must be called before the offset trail is restored.  As there, only the
+  // first trail entry of each buffer finds it (at its current minimum offset).
+  void UnindexPlacement(BufferIdx buffer_idx, size_t trail_size) {
+    OrderIndex* index = GetOrderIndex();
+    if (!index) return;
+    for (size_t idx = trail_size; idx < offset_trail_.size(); ++idx) {
+      const auto [other_idx, prev_offset] = offset_trail_[idx];
+      Reindex(*index, other_idx, min_offsets_[other_idx], prev_offset);
+    }
+    AddToIndex(*index, buffer_idx);
+  }
+
+  // Adds an unallocated buffer to an order index.
+  void AddToIndex(OrderIndex& index, BufferIdx buffer_idx) {
+    const Offset offset = min_offsets_[buffer_idx];
+    index.ordering.insert(
+        {.offset = offset, .preorder_idx = preorder_idxs_[buffer_idx]});
+  }
+
+  // Removes a buffer that has been placed from an order index.
+  void RemoveFromIndex(OrderIndex& index, BufferIdx buffer_idx) {
+    const Offset offset = min_offsets_[buffer_idx];
+    index.ordering.erase(
+        {.offset = offset, .preorder_idx = preorder_idxs_[buffer_idx]});
+  }
+
+  // Moves an unallocated buffer within an order index from one minimum offset
+  // to another (unless it isn't found at the former, e.g., if it was changed
+  // more than once by the same placement).  Any buffer whose minimum offset
+  // changes belongs to the innermost partition, since it overlaps with the
+  // buffer that was just placed.
+  void Reindex(OrderIndex& index, BufferIdx buffer_idx, Offset from_offset,
+               Offset to_offset) {
+    const PreorderIdx preorder_idx = preorder_idxs_[buffer_idx];
+    if (!index.ordering.erase(
+            {.offset = from_offset, .preorder_idx = preorder_idx})) {
+      return;
+    }
+    index.ordering.insert({.offset = to_offset, .preorder_idx = preorder_idx});
+  }
+
   // Returns 'true' if this partial solution satisfies consistency & inference
   // checks, otherwise 'false'.
   bool Check(const Partition& partition, Offset offset) {
-    for (SectionIdx s_idx = partition.section_range.lower();
-        s_idx < partition.section_range.upper(); ++s_idx) {
-      // Note: by construction, the given section_data object is guaranteed to
-      // have an element for every index in the partition's section_range.
-      auto [floor, total] = section_data_[s_idx];
-      if (params_.monotonic_floor) floor = std::max(offset, floor);
-      if (params_.section_inference) floor += total;
-      if (problem_.capacity < floor) return false;
+    // Note: by construction, the section floors & totals are guaranteed to have
+    // an element for every index in the partition's section_range.
+    const SectionRange& section_range = partition.section_range;
+    // Floors are never negative, so an offset of zero leaves them unchanged.
+    if (!params_.monotonic_floor) offset = 0;
+    if (section_tree_ &&
+        section_range.upper() - section_range.lower() >= kMinTreeSections) {
+      // Since max(offset, floor) + total = max(offset + total, floor + total),
+      // the maxima over the whole range suffice.
+      const SectionTree::Maxima maxima = section_tree_->Query(section_range);
+      const Offset height = params_.section_inference
+          ? std::max(offset + maxima.total, maxima.floor_total)
+          : std::max(offset, maxima.floor);
+      return height <= problem_.capacity;
     }
-    return true;
+    const Offset* floors = section_floors_.data() + section_range.lower();
+    const Offset* totals = section_totals_.data() + section_range.lower();
+    const SectionIdx num_sections =
+        section_range.upper() - section_range.lower();
+    return params_.section_inference
+        ? !ExceedsCapacity<true>(floors, totals, num_sections, offset,
+                                 problem_.capacity)
+        : !ExceedsCapacity<false>(floors, totals, num_sections, offset,
+                                  problem_.capacity);
   }
 
   // Orders unallocated buffers by their minimum possible offset values, using
-  // buffer areas as a tie-breaker.
-  std::vector<OrderData> ComputeOrdering(
+  // buffer areas as a tie-breaker.  The result is written into 'ordering' (whose
+  // capacity is reused from one search node to the next).
+  void ComputeOrdering(
       const std::vector<PreorderData>& preordering,
-      const std::vector<OrderData>& orig_ordering) {
-    std::vector<OrderData> ordering;
-    for (const auto [offset, preorder_idx] : orig_ordering) {
+      const std::vector<OrderData>* orig_ordering,
+      std::vector<OrderData>& ordering) {
+    ordering.clear();
+    for (const auto [offset, preorder_idx] : *orig_ordering) {
       const BufferIdx buffer_idx = preordering[preorder_idx].buffer_idx;
       // If this buffer has already been assigned, keep looking.
       if (assignment_.offsets[buffer_idx] != kNoOffset) continue;
@@ -318,7 +1079,22 @@ class SolverImpl {
           {.offset = new_offset, .preorder_idx = preorder_idx});
     }
     if (params_.dynamic_ordering) absl::c_sort(ordering, kDynamicComparator);
-    return ordering;
+    if (hint_first_) {
+      // Since the ordering is otherwise maintained, the first such buffer will
+      // be the next one in a canonical solution that matches the hints.
+      unhinted_.clear();
+      int num_hinted = 0;
+      for (const OrderData& order_data : ordering) {
+        const BufferIdx buffer_idx =
+            preordering[order_data.preorder_idx].buffer_idx;
+        if (problem_.buffers[buffer_idx].hint == order_data.offset) {
+          ordering[num_hinted++] = order_data;
+        } else {
+          unhinted_.push_back(order_data);
+        }
+      }
+      absl::c_copy(unhinted_, ordering.begin() + num_hinted);
+    }
   }
 
   // Determines the minimum height of any unallocated buffer ... no other buffer
@@ -335,170 +1111,804 @@ class SolverImpl {
     return min_height;
   }
 
-  // A recursive depth-first search for buffer offset assignment.  Returns 'kOk'
-  // if a feasible solution has been found, otherwise 'kNotFound' or potentially
-  // 'kDeadlineExceeded' / 'kAborted'.
-  absl::StatusCode SearchSolutions(
-      const Partition& partition,
-      const PreorderingComparator& preordering_comparator,
+  // As above, but for buffers held in an order index, which only need to be
+  // examined until their offsets reach the minimum height found so far.
+  Offset CalcMinHeight(
       const std::vector<PreorderData>& preordering,
-      const std::vector<OrderData>& orig_ordering,
+      const OrderIndex::Ordering& ordering) {
+    Offset min_height = INT_MAX;
+    for (const auto [offset, preorder_idx] : ordering) {
+      if (offset >= min_height) break;
+      min_height = std::min(min_height, offset + preordering[preorder_idx].size);
+    }
+    return min_height;
+  }
+
+  // A depth-first search for buffer offset assignment, which runs on an explicit
+  // stack of nodes (rather than recursively).  Returns 'kOk' if a feasible
+  // solution has been found, otherwise 'kNotFound' or potentially
+  // 'kDeadlineExceeded' / 'kAborted'.
+  absl::StatusCode Search(
+      const Context& context,
+      const std::vector<OrderData>* orig_ordering,
       Offset min_offset,
       PreorderIdx min_preorder_idx) {
+    const size_t base = stack_.size();
+    const std::optional<absl::StatusCode> status_code = EnterSearch(
+        context, orig_ordering, min_offset, min_preorder_idx, /*fixed_idx=*/0);
+    if (status_code) return *status_code;
+    return Run(base);
+  }
+
+  // Processes the stack until it has been unwound to the given size, returning
+  // the outcome of the node that was last popped.
+  absl::StatusCode Run(size_t base) {
+    // The outcome of the most recently finished child of the topmost node (if
+    // any).  A node that finishes is popped, becoming a child of the next one.
+    std::optional<absl::StatusCode> status_code;
+    while (stack_.size() > base) {
+      status_code = stack_.back().kind == Node::kSearch
+          ? StepSearch(status_code)
+          : StepDecompose(status_code);
+    }
+    return *status_code;
+  }
+
+  // Advances an index into the context's buffers with fixed offsets past any
+  // that have been allocated.
+  int SkipAllocatedFixed(const Context& context, int fixed_idx) const {
+    const std::vector<OrderData>& fixed = context.fixed;
+    while (fixed_idx < fixed.size()) {
+      const BufferIdx buffer_idx =
+          context.preordering[fixed[fixed_idx].preorder_idx].buffer_idx;
+      if (assignment_.offsets[buffer_idx] == kNoOffset) break;
+      ++fixed_idx;
+    }
+    return fixed_idx;
+  }
+
+  // Begins a search node (i.e., a call to what was once the recursive search).
+  // Returns its outcome if this can be determined straightaway, otherwise the
+  // node is pushed onto the stack and std::nullopt is returned.  The parent's
+  // fixed index (if any) is passed along, since every buffer with a fixed
+  // offset before it is allocated.
+  std::optional<absl::StatusCode> EnterSearch(
+      const Context& context,
+      const std::vector<OrderData>* orig_ordering,
+      Offset min_offset,
+      PreorderIdx min_preorder_idx,
+      int fixed_idx) {
     if (nodes_remaining_ <= 0) return absl::StatusCode::kAborted;
     --nodes_remaining_;
-    if (absl::Now() - start_time_ > params_.timeout || cancelled_) {
+    if (absl::Now() - start_time_ > params_.timeout || cancelled_ ||
+        (stop_ && stop_->IsSet())) {
       return absl::StatusCode::kDeadlineExceeded;
     }
-    const std::vector<OrderData> ordering =
-        ComputeOrdering(preordering, orig_ordering);
-    if (ordering.empty()) {
+    // Candidates are drawn straight from the order index if there is one, and
+    // are otherwise written out.
+    const OrderIndex* index = GetOrderIndex();
+    std::vector<OrderData>* ordering = nullptr;
+    if (!index) {
+      ordering = &orderings_[depth_];
+      ComputeOrdering(context.preordering, orig_ordering, *ordering);
+    }
+    if (ordering ? ordering->empty() : index->ordering.empty()) {
       // Store offsets for all the buffers that participate in this partition.
-      for (const BufferIdx buffer_idx : partition.buffer_idxs) {
+      for (const BufferIdx buffer_idx : context.partition.buffer_idxs) {
         solution_.offsets[buffer_idx] = assignment_.offsets[buffer_idx];
       }
       return absl::StatusCode::kOk;  // We've reached a leaf node.
     }
-    const Offset min_height = CalcMinHeight(preordering, ordering);
-    for (const auto [offset, preorder_idx] : ordering) {
-      const BufferIdx buffer_idx = preordering[preorder_idx].buffer_idx;
-      if (params_.canonical_only) {
-        // Buffers should be placed in non-increasing order by area.
-        if (offset < min_offset ||
-            (offset == min_offset && preorder_idx < min_preorder_idx)) continue;
+    const Offset min_height = ordering
+        ? CalcMinHeight(context.preordering, *ordering)
+        : CalcMinHeight(context.preordering, index->ordering);
+    Node& node = stack_.emplace_back();
+    node = {.context = &context, .ordering = ordering,
+            .min_offset = min_offset, .min_preorder_idx = min_preorder_idx,
+            .min_height = min_height,
+            .fixed_idx = SkipAllocatedFixed(context, fixed_idx),
+            .end_idx = ordering ? static_cast<int>(ordering->size()) : 0};
+    // If other workers are around, allow them to claim some of our children.
+    if (worker_ && nesting_ == 0) {
+      Frame& frame = worker_->frame_pool[depth_];
+      std::lock_guard<std::mutex> lock(worker_->mutex);
+      frame.depth = worker_->path.size();
+      frame.ordering = ordering;
+      frame.min_offset = min_offset;
+      frame.min_preorder_idx = min_preorder_idx;
+      frame.min_height = min_height;
+      frame.next_idx = 0;
+      worker_->frames.push_back(&frame);
+      node.frame = &frame;
+    }
+    if (node.frame && team_->idle > 0) Notify();
+    ++depth_;
+    return std::nullopt;
+  }
+
+  // Pops the topmost search node, returning its outcome.
+  absl::StatusCode LeaveSearch(absl::StatusCode status_code) {
+    const Node& node = stack_.back();
+    if (!node.lone_branch) {
+      --depth_;
+      if (node.frame) {
+        std::lock_guard<std::mutex> lock(worker_->mutex);
+        worker_->frames.pop_back();
       }
-      if (params_.check_dominance) {
-       // Check if this solution would introduce an unnecessary gap.
-        if (offset >= min_height) continue;
+      if (status_code == absl::StatusCode::kNotFound) ++*backtracks_;
+    }
+    stack_.pop_back();
+    return status_code;
+  }
+
+  // Advances the topmost search node, given the outcome of its latest child (if
+  // any): either a new child is begun, or the node itself is finished.
+  std::optional<absl::StatusCode> StepSearch(
+      std::optional<absl::StatusCode> status_code) {
+    Node& node = stack_.back();
+    while (true) {
+      if (status_code) {
+        EndBranch(node);
+        // If a feasible solution *or* timeout, abort search.
+        if (*status_code != absl::StatusCode::kNotFound) {
+          return LeaveSearch(*status_code);
+        }
+        if (node.hatless && params_.hatless_pruning) {
+          // Nobody else should bother either.
+          if (node.frame) node.frame->next_idx = node.end_idx;
+          return LeaveSearch(absl::StatusCode::kNotFound);
+        }
+        status_code.reset();
       }
-      if (const Buffer& buffer = problem_.buffers[buffer_idx]; buffer.offset) {
-        if (offset > *buffer.offset) continue;
+      if (!NextCandidate(node)) return LeaveSearch(absl::StatusCode::kNotFound);
+      const auto [offset, preorder_idx] = node.order_data;
+      bool fixed_offset_failure = false;
+      if (!BeginBranch(node, offset, preorder_idx, fixed_offset_failure)) {
+        continue;
+      }
+      if (fixed_offset_failure || !Check(node.context->partition, offset)) {
+        status_code = absl::StatusCode::kNotFound;
+        continue;
+      }
+      IndexPlacement(node.buffer_idx, node.offset_trail_size);
+      node.indexed = node.reindexed = true;
+      if (worker_ && nesting_ == 0) {
+        std::lock_guard<std::mutex> lock(worker_->mutex);
+        worker_->path.push_back({node.buffer_idx, offset});
+        node.shared_path = true;
       }
+      // Note: this node may be relocated once its child is pushed.
+      return params_.dynamic_decomposition
+          ? EnterDecompose(*node.context, node.ordering, offset, preorder_idx,
+                           node.fixed_idx, node.buffer_idx)
+          : EnterSearch(*node.context, node.ordering, offset, preorder_idx,
+                        node.fixed_idx);
+    }
+  }
+
+  // Claims the next candidate of a search node, returning 'false' if none
+  // remain.  Candidates drawn from the order index begin (and end) wherever the
+  // canonical & dominance checks would otherwise start (and stop) passing.
+  bool NextCandidate(Node& node) {
+    if (node.ordering) {
+      const int idx = node.frame ? node.frame->next_idx++ : node.next_idx++;
+      if (idx >= node.end_idx) return false;
+      node.order_data = (*node.ordering)[idx];
+      return true;
+    }
+    // Since children restore the index before returning, the candidate that
+    // follows our previous one (in order) is next.
+    const OrderIndex::Ordering& ordering = GetOrderIndex()->ordering;
+    auto& it = node.cursor;
+    if (node.next_idx++ == 0) {
+      it = params_.canonical_only
+          ? ordering.lower_bound({.offset = node.min_offset,
+                                  .preorder_idx = node.min_preorder_idx})
+          : ordering.begin();
+    } else if (node.reindexed) {
+      it = ordering.upper_bound(node.order_data);  // Our iterator is stale.
+    } else {
+      ++it;
+    }
+    node.reindexed = false;
+    if (it == ordering.end()) return false;
+    if (params_.check_dominance && it->offset >= node.min_height) return false;
+    node.order_data = *it;
+    return true;
+  }
+
+  // Places the next buffer of a search node at the given offset, unless it can
+  // be pruned beforehand (in which case 'false' is returned).
+  bool BeginBranch(Node& node, Offset offset, PreorderIdx preorder_idx,
+                   bool& fixed_offset_failure) {
+    const BufferIdx buffer_idx =
+        node.context->preordering[preorder_idx].buffer_idx;
+    if (params_.canonical_only) {
+      // Buffers should be placed in non-increasing order by area.
+      if (offset < node.min_offset ||
+          (offset == node.min_offset && preorder_idx < node.min_preorder_idx)) {
+        return false;
+      }
+      // Nor could any buffer with a fixed offset that precedes this one.
+      const std::vector<OrderData>& fixed = node.context->fixed;
+      if (node.fixed_idx < fixed.size() &&
+          kDynamicComparator(fixed[node.fixed_idx],
+                             {.offset = offset, .preorder_idx = preorder_idx})) {
+        return false;
+      }
+    }
+    if (params_.check_dominance) {
+     // Check if this solution would introduce an unnecessary gap.
+      if (offset >= node.min_height) return false;
+    }
+    if (const Buffer& buffer = problem_.buffers[buffer_idx]; buffer.offset) {
+      if (offset > *buffer.offset) return false;
+    }
+    assignment_.offsets[buffer_idx] = offset;
+    node.buffer_idx = buffer_idx;
+    node.offset_trail_size = offset_trail_.size();
+    node.section_trail_size = section_trail_.size();
+    node.tree_trail_size = section_tree_ ? section_tree_->trail_size() : 0;
+    node.shared_path = false;
+    node.indexed = false;
+    node.hatless = UpdateMinOffsets(buffer_idx, fixed_offset_failure);
+    UpdateSectionData(buffer_idx);
+    return true;
+  }
+
+  // Undoes the placement made by BeginBranch.
+  void EndBranch(Node& node) {
+    if (node.shared_path) {
+      std::lock_guard<std::mutex> lock(worker_->mutex);
+      worker_->path.pop_back();
+    }
+    if (node.indexed) UnindexPlacement(node.buffer_idx, node.offset_trail_size);
+    RestoreSectionData(node.section_trail_size, node.tree_trail_size,
+                       node.buffer_idx);
+    RestoreMinOffsets(node.offset_trail_size);
+    assignment_.offsets[node.buffer_idx] = kNoOffset;  // Mark it unallocated.
+  }
+
+  // Searches a partition using several workers (each with its own copy of the
+  // search state) that steal unexplored branches from one another.  Only nodes
+  // outside of any dynamic decomposition are shared, since a branch stolen from
+  // such a node is guaranteed to cover the rest of the partition.  The workers
+  // run on the thread pool, and those with nothing to steal wait to be woken.
+  absl::StatusCode ParallelSearch(const Context& context) {
+    const Partition& partition = context.partition;
+    const int num_workers = params_.search_threads;
+    const StopFlag* outer_stop = stop_;
+    Team team(num_workers, orderings_.size(), outer_stop);
+    team.solution.offsets.resize(problem_.buffers.size(), kNoOffset);
+    const int64_t nodes_remaining = nodes_remaining_ / num_workers;
+    std::vector<std::unique_ptr<SolverImpl>> helpers;
+    helpers.reserve(num_workers - 1);
+    for (int worker_idx = 1; worker_idx < num_workers; ++worker_idx) {
+      SolverImpl& helper = *helpers.emplace_back(Fork(&team.stop));
+      helper.nodes_remaining_ = nodes_remaining;
+      helper.team_ = &team;
+      helper.worker_ = &team.workers[worker_idx];
+    }
+    nodes_remaining_ = nodes_remaining;
+    stop_ = &team.stop;
+    team_ = &team;
+    worker_ = &team.workers.front();
+    team.busy = 1;  // We'll begin at the root, while the helpers go stealing.
+    search_pool_->ParallelFor(num_workers, [&](int worker_idx) {
+      if (worker_idx > 0) {
+        helpers[worker_idx - 1]->Work(context);
+        return;
+      }
+      Report(partition, Search(context, &context.ordering, /*min_offset=*/0,
+                               /*min_preorder_idx=*/0));
+      FinishBranch();
+      Work(context);
+    });
+    for (const std::unique_ptr<SolverImpl>& helper : helpers) {
+      nodes_remaining_ += helper->nodes_remaining_;
+      *backtracks_ += helper->fork_backtracks_;
+    }
+    stop_ = outer_stop;
+    team_ = nullptr;
+    worker_ = nullptr;
+    if (!team.status_code) return absl::StatusCode::kNotFound;
+    if (*team.status_code == absl::StatusCode::kOk) {
+      for (const BufferIdx buffer_idx : partition.buffer_idxs) {
+        solution_.offsets[buffer_idx] = team.solution.offsets[buffer_idx];
+      }
+    }
+    return *team.status_code;
+  }
+
+  // Repeatedly steals & explores branches until the team's search concludes.
+  void Work(const Context& context) {
+    Task task;
+    while (WaitToSteal(task)) {
+      Report(context.partition, SearchTask(context, task));
+      FinishBranch();
+    }
+  }
+
+  // Blocks until a branch has been stolen (returning 'true'), or until there is
+  // nothing left to steal because nobody is busy or the search has concluded.
+  bool WaitToSteal(Task& task) {
+    std::unique_lock<std::mutex> lock(team_->mutex);
+    ++team_->idle;
+    bool stolen = false;
+    while (!team_->stop.IsSet() && team_->busy > 0 && !(stolen = Steal(task))) {
+      team_->cv.wait(lock);
+    }
+    --team_->idle;
+    return stolen;
+  }
+
+  // Marks a branch explored by this worker as finished, waking any idle workers
+  // if it was the last one.
+  void FinishBranch() {
+    if (--team_->busy == 0) Notify();
+  }
+
+  // Wakes the team's idle workers.  The team's lock is taken beforehand, so that
+  // a worker about to wait can't miss this.
+  void Notify() {
+    { std::lock_guard<std::mutex> lock(team_->mutex); }
+    team_->cv.notify_all();
+  }
+
+  // Attempts to claim an unexplored child of some other worker's open node,
+  // preferring shallow nodes (whose subtrees are likely to be larger).
+  bool Steal(Task& task) {
+    const int num_workers = team_->workers.size();
+    const int self_idx = worker_ - team_->workers.data();
+    for (int offset = 1; offset < num_workers; ++offset) {
+      Worker& victim = team_->workers[(self_idx + offset) % num_workers];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      for (Frame* frame : victim.frames) {
+        const int num_children = frame->ordering->size();
+        if (frame->next_idx >= num_children) continue;
+        const int child_idx = frame->next_idx++;
+        if (child_idx >= num_children) continue;
+        ++team_->busy;  // Must happen while the victim is known to be busy.
+        task.path.assign(victim.path.begin(),
+                         victim.path.begin() + frame->depth);
+        task.ordering = *frame->ordering;
+        task.min_offset = frame->min_offset;
+        task.min_preorder_idx = frame->min_preorder_idx;
+        task.min_height = frame->min_height;
+        task.child_idx = child_idx;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Reconstructs the state of a stolen node by replaying the decisions that led
+  // to it, explores the stolen child, and then reverts to the partition's root.
+  absl::StatusCode SearchTask(const Context& context, const Task& task) {
+    struct TrailSizes {
+      size_t offset_trail_size;
+      size_t section_trail_size;
+      size_t tree_trail_size;
+    };
+    std::vector<TrailSizes> trail_sizes;
+    trail_sizes.reserve(task.path.size());
+    for (const auto [buffer_idx, offset] : task.path) {
       assignment_.offsets[buffer_idx] = offset;
-      absl::flat_hash_set<SectionIdx> affected_sections;
+      trail_sizes.push_back({offset_trail_.size(), section_trail_.size(),
+                             section_tree_ ? section_tree_->trail_size() : 0});
       bool fixed_offset_failure = false;
-      auto offset_changes = UpdateMinOffsets(buffer_idx, affected_sections,
-		                             fixed_offset_failure);
-      std::vector<SectionChange> section_changes =
-          UpdateSectionData(affected_sections, buffer_idx);
-      absl::StatusCode status_code = absl::StatusCode::kNotFound;
-      if (!fixed_offset_failure && Check(partition, offset)) {
-        status_code =
-            params_.dynamic_decomposition
-                ? DynamicallyDecompose(partition, preordering_comparator,
-                    preordering, ordering, offset, preorder_idx, buffer_idx)
-                : SearchSolutions(partition, preordering_comparator,
-                    preordering, ordering, offset, preorder_idx);
-      }
-      RestoreSectionData(section_changes, buffer_idx);
-      if (offset_changes) RestoreMinOffsets(*offset_changes);
-      assignment_.offsets[buffer_idx] = kNoOffset;  // Mark it unallocated.
-      // If a feasible solution *or* timeout, abort search.
-      if (status_code != absl::StatusCode::kNotFound) return status_code;
-      if (!offset_changes && params_.hatless_pruning) break;
-    }
-    ++backtracks_;
-    return absl::StatusCode::kNotFound;  // No feasible solution found.
+      UpdateMinOffsets(buffer_idx, fixed_offset_failure);
+      UpdateSectionData(buffer_idx);
+      IndexPlacement(buffer_idx, trail_sizes.back().offset_trail_size);
+      if (params_.dynamic_decomposition) ReduceCuts(buffer_idx);
+      solution_.offsets[buffer_idx] = offset;
+    }
+    {
+      std::lock_guard<std::mutex> lock(worker_->mutex);
+      worker_->path = task.path;
+    }
+    // Explore the stolen child (and nothing else) of the reconstructed node.
+    const size_t base = stack_.size();
+    stack_.push_back({.context = &context, .ordering = &task.ordering,
+                      .min_offset = task.min_offset,
+                      .min_preorder_idx = task.min_preorder_idx,
+                      .min_height = task.min_height,
+                      .fixed_idx = SkipAllocatedFixed(context, 0),
+                      .next_idx = task.child_idx,
+                      .end_idx = task.child_idx + 1, .lone_branch = true});
+    const absl::StatusCode status_code = Run(base);
+    {
+      std::lock_guard<std::mutex> lock(worker_->mutex);
+      worker_->path.clear();
+    }
+    for (int idx = task.path.size() - 1; idx >= 0; --idx) {
+      const BufferIdx buffer_idx = task.path[idx].buffer_idx;
+      if (params_.dynamic_decomposition) RestoreCuts(buffer_idx);
+      UnindexPlacement(buffer_idx, trail_sizes[idx].offset_trail_size);
+      RestoreSectionData(trail_sizes[idx].section_trail_size,
+                         trail_sizes[idx].tree_trail_size, buffer_idx);
+      RestoreMinOffsets(trail_sizes[idx].offset_trail_size);
+      assignment_.offsets[buffer_idx] = kNoOffset;
+    }
+    return status_code;
+  }
+
+  // Records the outcome of a branch explored by this worker.  The first
+  // conclusive outcome (i.e., anything besides 'kNotFound') ends the search.
+  void Report(const Partition& partition, absl::StatusCode status_code) {
+    if (status_code == absl::StatusCode::kNotFound) return;
+    std::lock_guard<std::mutex> lock(team_->mutex);
+    if (team_->status_code) return;  // Somebody else got here first.
+    team_->status_code = status_code;
+    if (status_code == absl::StatusCode::kOk) {
+      for (const BufferIdx buffer_idx : partition.buffer_idxs) {
+        team_->solution.offsets[buffer_idx] = solution_.offsets[buffer_idx];
+      }
+    }
+    team_->stop.stopped = true;
+    team_->cv.notify_all();
+  }
+
+  // Reduces the cuts between sections spanned by this buffer.
+  void ReduceCuts(BufferIdx buffer_idx) {
+    const BufferData& buffer_data = sweep_result_.buffer_data[buffer_idx];
+    const std::vector<SectionSpan>& section_spans = buffer_data.section_spans;
+    for (SectionIdx s_idx = section_spans.front().section_range.lower();
+        s_idx + 1 < section_spans.back().section_range.upper(); ++s_idx) {
+      --cuts_[s_idx];
+    }
+  }
+
+  // Restores the cuts between sections spanned by this buffer.
+  void RestoreCuts(BufferIdx buffer_idx) {
+    const BufferData& buffer_data = sweep_result_.buffer_data[buffer_idx];
+    const std::vector<SectionSpan>& section_spans = buffer_data.section_spans;
+    for (SectionIdx s_idx = section_spans.front().section_range.lower();
+        s_idx + 1 < section_spans.back().section_range.upper(); ++s_idx) {
+      ++cuts_[s_idx];
+    }
+  }
+
+  // Collects the unallocated buffers of a partition that reside within the given
+  // range of sections.
+  void CollectBuffers(const Partition& partition,
+                      const SectionRange& section_range,
+                      std::vector<BufferIdx>& buffer_idxs) {
+    for (const BufferIdx other_idx : partition.buffer_idxs) {
+      // A minor optimization (mutants ok).
+      if (assignment_.offsets[other_idx] != kNoOffset) continue;
+      const BufferData& other_data = sweep_result_.buffer_data[other_idx];
+      const SectionRange other_range = {
+        other_data.section_spans.front().section_range.lower(),
+        other_data.section_spans.back().section_range.upper()
+      };
+      if (!(other_range.upper() <= section_range.lower() ||
+            section_range.upper() <= other_range.lower())) {
+        buffer_idxs.push_back(other_idx);
+      }
+    }
   }
 
   // Decomposes the problem into partitions and solves each independently.  If
   // any subproblem is found to be infeasible, no further search is performed.
-  absl::StatusCode DynamicallyDecompose(
-      const Partition& partition,
-      const PreorderingComparator& preordering_comparator,
-      const std::vector<PreorderData>& preordering,
-      const std::vector<OrderData>& orig_ordering,
+  // Like EnterSearch, returns an outcome only if it is known straightaway.
+  std::optional<absl::StatusCode> EnterDecompose(
+      const Context& context,
+      const std::vector<OrderData>* orig_ordering,
       Offset min_offset,
       PreorderIdx min_preorder_idx,
+      int fixed_idx,
       BufferIdx buffer_idx) {
+    const Partition& partition = context.partition;
     solution_.offsets[buffer_idx] = assignment_.offsets[buffer_idx];
-    // Reduce the cuts between sections spanned by this buffer (and store all
-    // zero-cut section indices into 'cutpoints', to be solved separately).
-    std::vector<SectionIdx> cutpoints = {partition.section_range.lower()};
+    // Reduce the cuts between sections spanned by this buffer (and push all
+    // zero-cut section indices onto the cutpoint stack, to be solved separately).
+    const size_t begin = cutpoints_.size();
+    cutpoints_.push_back(partition.section_range.lower());
     const BufferData& buffer_data = sweep_result_.buffer_data[buffer_idx];
     const std::vector<SectionSpan>& section_spans = buffer_data.section_spans;
     for (SectionIdx s_idx = section_spans.front().section_range.lower();
       s_idx + 1 < section_spans.back().section_range.upper(); ++s_idx) {
-      if (--cuts_[s_idx] == 0) cutpoints.push_back(s_idx + 1);
+      if (--cuts_[s_idx] == 0) cutpoints_.push_back(s_idx + 1);
     }
-    absl::StatusCode status_code = absl::StatusCode::kOk;
-    if (cutpoints.size() == 1) {
-      status_code =
-          SearchSolutions(partition, preordering_comparator, preordering,
-              orig_ordering, min_offset, min_preorder_idx);
-    } else {
-      cutpoints.push_back(partition.section_range.upper());
-      for (int c_idx = 1; c_idx < cutpoints.size(); ++c_idx) {
-        // Determine the range of this sub-partition.
+    const bool split = cutpoints_.size() - begin > 1;
+    if (split) cutpoints_.push_back(partition.section_range.upper());
+    // Members of a parallel search team don't submit nested work to the pool:
+    // while waiting on it, their thread might pick up one of the team's own
+    // helpers, which would then wait on a branch suspended beneath it.
+    if (split && pool_ && !team_) {
+      // Sub-partitions may be solved concurrently, so handle them all at once.
+      std::vector<Partition> sub_partitions;
+      for (size_t c_idx = begin + 1; c_idx < cutpoints_.size(); ++c_idx) {
         const SectionRange section_range =
-            {cutpoints[c_idx - 1], cutpoints[c_idx]};
-        // Determine the contents of this sub-partition.
-        std::vector<BufferIdx> buffer_idxs;
-        for (const BufferIdx other_idx : partition.buffer_idxs) {
-          // A minor optimization (mutants ok).
-          if (assignment_.offsets[other_idx] != kNoOffset) continue;
-          const BufferData& other_data = sweep_result_.buffer_data[other_idx];
-          const SectionRange other_range = {
-            other_data.section_spans.front().section_range.lower(),
-            other_data.section_spans.back().section_range.upper()
-          };
-          if (!(other_range.upper() <= section_range.lower() ||
-                section_range.upper() <= other_range.lower())) {
-            buffer_idxs.push_back(other_idx);
-          }
-        }
-        if (buffer_idxs.empty()) continue;
-        // Create the sub-partition and solve it.
-        const Partition sub_partition =
-            {.buffer_idxs = buffer_idxs, .section_range = section_range};
-        absl::Status status = SubSolve(sub_partition, preordering_comparator);
-        if (!status.ok()) {
-          status_code = status.code();
-          break;
+            {cutpoints_[c_idx - 1], cutpoints_[c_idx]};
+        Partition sub_partition = {.section_range = section_range};
+        CollectBuffers(partition, section_range, sub_partition.buffer_idxs);
+        if (sub_partition.buffer_idxs.empty()) continue;
+        sub_partitions.push_back(std::move(sub_partition));
+      }
+      const absl::StatusCode status_code = SolveSubPartitions(sub_partitions,
+          *context.preordering_comparator).code();
+      cutpoints_.resize(begin);
+      RestoreCuts(buffer_idx);
+      return status_code;
+    }
+    stack_.push_back({.kind = Node::kDecompose, .context = &context,
+                      .ordering = orig_ordering, .min_offset = min_offset,
+                      .min_preorder_idx = min_preorder_idx,
+                      .fixed_idx = fixed_idx, .buffer_idx = buffer_idx,
+                      .split = split,
+                      .cutpoints_begin = begin,
+                      .cutpoints_end = cutpoints_.size(),
+                      .cutpoint_idx = begin});
+    return std::nullopt;
+  }
+
+  // Pops the topmost decomposition node, returning its outcome.
+  absl::StatusCode LeaveDecompose(absl::StatusCode status_code) {
+    const Node& node = stack_.back();
+    cutpoints_.resize(node.cutpoints_begin);
+    RestoreCuts(node.buffer_idx);  // Restore all cuts to their previous values.
+    stack_.pop_back();
+    return status_code;
+  }
+
+  // Advances the topmost decomposition node, given the outcome of its latest
+  // child (if any).  Without a split, its only child searches the remainder of
+  // the partition; otherwise, each non-empty sub-partition is solved in turn.
+  std::optional<absl::StatusCode> StepDecompose(
+      std::optional<absl::StatusCode> status_code) {
+    Node& node = stack_.back();
+    if (!node.split) {
+      if (status_code) return LeaveDecompose(*status_code);
+      return EnterSearch(*node.context, node.ordering, node.min_offset,
+                         node.min_preorder_idx, node.fixed_idx);
+    }
+    if (status_code) {
+      --nesting_;
+      RecordSubPartition(contexts_.back().partition, *status_code);
+      PopOrderIndex(contexts_.back());
+      contexts_.pop_back();
+      if (*status_code != absl::StatusCode::kOk) {
+        return LeaveDecompose(*status_code);
+      }
+    }
+    while (++node.cutpoint_idx < node.cutpoints_end) {
+      // Determine the range & contents of this sub-partition.
+      const SectionRange section_range =
+          {cutpoints_[node.cutpoint_idx - 1], cutpoints_[node.cutpoint_idx]};
+      Context& sub_context = contexts_.emplace_back();
+      sub_context.partition.section_range = section_range;
+      CollectBuffers(node.context->partition, section_range,
+                     sub_context.partition.buffer_idxs);
+      if (sub_context.partition.buffer_idxs.empty()) {
+        contexts_.pop_back();
+        continue;
+      }
+      // Skip the search if this sub-partition's outcome is already known.
+      if (const std::optional<absl::StatusCode> cached_status_code =
+              LookupSubPartition(sub_context.partition)) {
+        contexts_.pop_back();
+        if (*cached_status_code != absl::StatusCode::kOk) {
+          return LeaveDecompose(*cached_status_code);
         }
+        continue;
       }
+      // Create the sub-partition and solve it.
+      PrepareContext(*node.context->preordering_comparator, sub_context);
+      PushOrderIndex(sub_context, /*shared=*/false);
+      ++nesting_;
+      return EnterSearch(sub_context, &sub_context.ordering, /*min_offset=*/0,
+                         /*min_preorder_idx=*/0, /*fixed_idx=*/0);
     }
-    // Restore all section cuts to their previous values.
-    for (SectionIdx s_idx = section_spans.front().section_range.lower();
-        s_idx + 1 < section_spans.back().section_range.upper(); ++s_idx) {
-      ++cuts_[s_idx];
+    return LeaveDecompose(absl::StatusCode::kOk);
+  }
+
+  // Solves the sub-partitions found by a dynamic decomposition, concurrently if
+  // enough of them are large enough to be worth the trouble.
+  absl::Status SolveSubPartitions(
+      const std::vector<Partition>& sub_partitions,
+      const PreorderingComparator& preordering_comparator) {
+    const int num_large = absl::c_count_if(sub_partitions,
+        [](const Partition& sub_partition) {
+          return sub_partition.buffer_idxs.size() >= kMinParallelSearchBuffers;
+        });
+    ++nesting_;
+    absl::Status status = absl::OkStatus();
+    if (num_large > 1) {
+      status = SolveConcurrently(sub_partitions,
+          [&](SolverImpl& solver, const Partition& sub_partition) {
+            return solver.SolveSubPartition(sub_partition,
+                                            preordering_comparator);
+          });
+    } else {
+      for (const Partition& sub_partition : sub_partitions) {
+        status = SolveSubPartition(sub_partition, preordering_comparator);
+        if (!status.ok()) break;
+      }
+    }
+    --nesting_;
+    return status;
+  }
+
+  // Solves a sub-partition found by a dynamic decomposition, unless its outcome
+  // is already known.
+  absl::Status SolveSubPartition(
+      const Partition& sub_partition,
+      const PreorderingComparator& preordering_comparator) {
+    if (const std::optional<absl::StatusCode> cached_status_code =
+            LookupSubPartition(sub_partition)) {
+      if (*cached_status_code == absl::StatusCode::kOk) return absl::OkStatus();
+      return absl::Status(*cached_status_code,
+                          "Error encountered during search.");
+    }
+    absl::Status status = SubSolve(sub_partition, preordering_comparator);
+    RecordSubPartition(sub_partition, status.code());
+    return status;
+  }
+
+  // Builds the key under which the outcome of a sub-partition is recorded (in
+  // terms of the current search state).
+  std::vector<int64_t> TranspositionKey(const Partition& sub_partition) const {
+    const SectionRange& section_range = sub_partition.section_range;
+    const std::vector<BufferIdx>& buffer_idxs = sub_partition.buffer_idxs;
+    std::vector<int64_t> key;
+    key.reserve(2 + 2 * buffer_idxs.size() + section_range.upper() -
+                section_range.lower());
+    key.push_back(section_range.lower());
+    key.push_back(section_range.upper());
+    for (const BufferIdx buffer_idx : buffer_idxs) {
+      key.push_back(buffer_idx);
+      key.push_back(min_offsets_[buffer_idx]);
+    }
+    key.insert(key.end(), section_floors_.begin() + section_range.lower(),
+               section_floors_.begin() + section_range.upper());
+    return key;
+  }
+
+  // Returns the recorded outcome of a sub-partition (if any), in which case the
+  // offsets of a feasible one are stored into our solution.
+  std::optional<absl::StatusCode> LookupSubPartition(
+      const Partition& sub_partition) {
+    if (!transpositions_) return std::nullopt;
+    const std::optional<absl::StatusCode> status_code =
+        transpositions_->Lookup(TranspositionKey(sub_partition), offsets_);
+    if (status_code == absl::StatusCode::kOk) {
+      const std::vector<BufferIdx>& buffer_idxs = sub_partition.buffer_idxs;
+      for (int idx = 0; idx < buffer_idxs.size(); ++idx) {
+        solution_.offsets[buffer_idxs[idx]] = offsets_[idx];
+      }
     }
     return status_code;
   }
 
+  // Records the outcome of a sub-partition that was just searched, provided it
+  // was conclusive (i.e., the search wasn't cut short).  Since the search state
+  // is restored afterwards, the key matches the one from beforehand.
+  void RecordSubPartition(const Partition& sub_partition,
+                          absl::StatusCode status_code) {
+    if (!transpositions_) return;
+    if (status_code != absl::StatusCode::kOk &&
+        status_code != absl::StatusCode::kNotFound) {
+      return;
+    }
+    std::vector<Offset> offsets;
+    if (status_code == absl::StatusCode::kOk) {
+      offsets.reserve(sub_partition.buffer_idxs.size());
+      for (const BufferIdx buffer_idx : sub_partition.buffer_idxs) {
+        offsets.push_back(solution_.offsets[buffer_idx]);
+      }
+    }
+    transpositions_->Insert(TranspositionKey(sub_partition), status_code,
+                            std::move(offsets));
+  }
+
   const SolverParams& params_;
   const absl::Time start_time_;
   const Problem& problem_;
   const SweepResult& sweep_result_;
-  int64_t& backtracks_;
+  int64_t* backtracks_;
   std::atomic<bool>& cancelled_;
+  ThreadPool* pool_;  // Non-null if partitions may be solved concurrently.
+  ThreadPool* search_pool_;  // Non-null if partitions may be searched jointly.
 
   Solution assignment_;
   Solution solution_;
   std::vector<Offset> min_offsets_;
-  std::vector<SectionData> section_data_;
+  std::vector<PreorderIdx> preorder_idxs_;  // Within the innermost partition.
+  // The lowest viable offset for any buffer in each section, and the sum of the
+  // unallocated buffer sizes therein (stored apart so that Check vectorizes).
+  std::vector<Offset> section_floors_;
+  std::vector<Offset> section_totals_;
+  // Present while searching a partition that spans enough sections to query it.
+  std::optional<SectionTree> section_tree_;
   std::vector<CutCount> cuts_;
   int64_t nodes_remaining_ = std::numeric_limits<int64_t>::max();
+  int nesting_ = 0;  // The number of dynamic decompositions we're nested in.
+  bool hint_first_ = false;  // Set if hints are present (and should be used).
+
+  // Storage reused across search nodes, so that search needn't allocate.
+  int depth_ = 0;  // The number of buffers placed since the search began.
+  std::vector<std::vector<OrderData>> orderings_;  // One for each depth.
+  std::vector<OrderData> unhinted_;
+  std::vector<OffsetChange> offset_trail_;
+  std::vector<SectionChange> section_trail_;
+  std::vector<SectionIdx> affected_sections_;
+  std::vector<uint32_t> section_marks_;  // Affected iff equal to the epoch.
+  uint32_t section_epoch_ = 0;
+  std::vector<SectionIdx> cutpoints_;
+  std::vector<Node> stack_;  // The explicit stack of nodes being searched.
+  std::deque<Context> contexts_;  // The (sub-)partitions being searched.
+  std::vector<OrderIndex> indices_;  // One per (sub-)partition being searched.
+  Team* team_ = nullptr;  // Non-null when cooperating with other workers.
+  Worker* worker_ = nullptr;
+  const StopFlag* stop_ = nullptr;  // Non-null when running concurrently.
+  int64_t fork_backtracks_ = 0;  // Backtracks incurred by a forked solver.
+  // Present if sub-partition outcomes are recorded (shared with any forks).
+  std::shared_ptr<TranspositionTable> transpositions_;
+  std::vector<Offset> offsets_;  // Storage for offsets found in the table.
+  std::vector<uint64_t> ranks_;  // Random tie-breakers (if any), per buffer.
 };  // class SolverImpl
 
+// Runs a portfolio of solvers (one per preordering heuristic) concurrently on
+// the thread pool, which must have a thread for each of them.  The first to
+// reach a conclusion -- i.e., a solution or a proof of infeasibility -- stops
+// the remaining ones (without touching the caller's 'cancelled' flag).
+absl::StatusOr<Solution> SolvePortfolio(const SolverParams& params,
+    const absl::Time start_time, const Problem& problem,
+    const SweepResult& sweep_result, int64_t* backtracks,
+    std::atomic<bool>& cancelled, ThreadPool& pool) {
+  const auto num_heuristics = params.preordering_heuristics.size();
+  std::vector<SolverParams> portfolio_params(num_heuristics, params);
+  std::vector<absl::StatusOr<Solution>> results(num_heuristics);
+  std::vector<int64_t> portfolio_backtracks(num_heuristics, 0);
+  std::atomic<int> winner = -1;
+  StopFlag stop;  // Set once some solver has won.
+  for (int idx = 0; idx < num_heuristics; ++idx) {
+    portfolio_params[idx].preordering_heuristics =
+        {params.preordering_heuristics[idx]};
+  }
+  pool.ParallelFor(num_heuristics, [&](int idx) {
+    SolverImpl solver_impl(portfolio_params[idx], start_time, problem,
+        sweep_result, &portfolio_backtracks[idx], cancelled, &pool, &stop);
+    results[idx] = solver_impl.Solve();
+    // If this solver timed out (or was stopped), it has nothing to report.
+    const absl::StatusCode code = results[idx].status().code();
+    if (code != absl::StatusCode::kOk &&
+        code != absl::StatusCode::kNotFound) return;
+    int expected = -1;
+    if (winner.compare_exchange_strong(expected, idx)) stop.stopped = true;
+  });
+  for (const int64_t solver_backtracks : portfolio_backtracks) {
+    *backtracks += solver_backtracks;
+  }
+  if (winner == -1) return results.front();
+  return results[winner];
+}
+
 }  // namespace
 
-PreorderingComparator::PreorderingComparator(const PreorderingHeuristic& h) :
-    preordering_heuristic_(h) {}
-
-bool PreorderingComparator::operator()(
-    const PreorderData& a, const PreorderData& b) const {
-  for (const char &c : preordering_heuristic_) {
-    if (c == 'A' && a.area != b.area) return a.area > b.area;
-    if (c == 'C' && a.sections != b.sections) return a.sections > b.sections;
-    if (c == 'L' && a.lower != b.lower) return a.lower > b.lower;
-    if (c == 'O' && a.overlaps != b.overlaps) return a.overlaps > b.overlaps;
-    if (c == 'T' && a.total != b.total) return a.total > b.total;
-    if (c == 'U' && a.upper != b.upper) return a.upper > b.upper;
-    if (c == 'W' && a.width != b.width) return a.width > b.width;
-    if (c == 'Z' && a.size != b.size) return a.size > b.size;
-  }
-  return a.buffer_idx < b.buffer_idx;
+Capacity CalcCapacityLowerBound(const Problem& problem,
+                                const SweepResult& sweep_result) {
+  std::vector<Capacity> totals(sweep_result.sections.size());
+  Capacity lower_bound = 0;
+  for (BufferIdx buffer_idx = 0; buffer_idx < problem.buffers.size();
+      ++buffer_idx) {
+    const BufferData& buffer_data = sweep_result.buffer_data[buffer_idx];
+    for (const SectionSpan& section_span : buffer_data.section_spans) {
+      const SectionRange& section_range = section_span.section_range;
+      const Window& window = section_span.window;
+      for (SectionIdx s_idx = section_range.lower();
+          s_idx < section_range.upper(); ++s_idx) {
+        totals[s_idx] += window.upper() - window.lower();
+        lower_bound = std::max(lower_bound, totals[s_idx]);
+      }
+    }
+    if (const Buffer& buffer = problem.buffers[buffer_idx]; buffer.offset) {
+      lower_bound = std::max(lower_bound, *buffer.offset + buffer.size);
+    }
+  }
+  return lower_bound;
 }
 
 Solver::Solver() {}
@@ -510,25 +1920,90 @@ Solver::Solver(const SolverParams& params) : params_(params) {}
 absl::StatusOr<Solution> Solver::Solve(const Problem& problem) {
   backtracks_ = 0;  // Reset the backtrack counter.
   cancelled_ = false;
+  best_solution_.reset();
   return SolveWithStartTime(problem, absl::Now());
 }
 
 absl::StatusOr<Solution> Solver::SolveWithStartTime(const Problem& problem,
                                                     absl::Time start_time) {
-  const SweepResult sweep_result = Sweep(problem);
-  SolverImpl solver_impl(
-      params_, start_time, problem, sweep_result, &backtracks_, cancelled_);
-  return solver_impl.Solve();
+  return SolveWithSweepResult(
+      problem, SweepWithThreads(problem, params_.sweep_threads), start_time);
+}
+
+absl::StatusOr<Solution> Solver::SolveWithSweepResult(
+    const Problem& problem, const SweepResult& sweep_result,
+    absl::Time start_time) {
+  // Partitions that are solved concurrently share a single pool with the
+  // workers searching each of them (and with any portfolio of heuristics, each
+  // of which is given a thread), so as not to oversubscribe the machine.
+  const bool portfolio = params_.parallel_portfolio &&
+      params_.preordering_heuristics.size() > 1;
+  std::optional<ThreadPool> thread_pool;
+  const int num_threads = std::max({params_.partition_threads,
+      params_.search_threads,
+      portfolio ? static_cast<int>(params_.preordering_heuristics.size()) : 1});
+  if (num_threads > 1) thread_pool.emplace(num_threads - 1);
+  ThreadPool* pool = thread_pool ? &*thread_pool : nullptr;
+  const auto search = [&](const Problem& problem) -> absl::StatusOr<Solution> {
+    if (portfolio) {
+      return SolvePortfolio(params_, start_time, problem, sweep_result,
+                            &backtracks_, cancelled_, *thread_pool);
+    }
+    SolverImpl solver_impl(params_, start_time, problem, sweep_result,
+                           &backtracks_, cancelled_, pool);
+    return solver_impl.Solve();
+  };
+  if (!params_.anytime) return search(problem);
+  std::vector<PreorderData> preordering = CalcPreordering(problem, sweep_result);
+  absl::c_sort(preordering, PreorderingComparator(
+      params_.preordering_heuristics.front()));
+  UpdateBestSolution(problem,
+                     PlaceOnSkyline(problem, sweep_result, preordering));
+  // Search beneath the best peak found so far, halving its distance from the
+  // capacity each time, so that better solutions are kept along the way.
+  Problem attempt = problem;
+  while (true) {
+    const Capacity peak = problem.peak(*best_solution_);
+    const Capacity excess = peak - problem.capacity;
+    attempt.capacity = excess <= 0
+        ? problem.capacity
+        : peak - std::max<Capacity>(excess / 2, 1);
+    absl::StatusOr<Solution> solution = search(attempt);
+    if (!solution.ok()) {
+      // Infeasibility at (or above) the capacity is conclusive, but a timeout
+      // leaves the best solution so far, which is returned if it fits.
+      if (!absl::IsNotFound(solution.status()) &&
+          problem.peak(*best_solution_) <= problem.capacity) {
+        return *best_solution_;
+      }
+      return solution;
+    }
+    UpdateBestSolution(problem, *solution);
+    if (attempt.capacity == problem.capacity) return solution;
+  }
+}
+
+void Solver::UpdateBestSolution(const Problem& problem, Solution solution) {
+  if (best_solution_ &&
+      problem.peak(*best_solution_) <= problem.peak(solution)) {
+    return;
+  }
+  best_solution_ = std::move(solution);
 }
 
 int64_t Solver::get_backtracks() const { return backtracks_; }
 
+const std::optional<Solution>& Solver::get_best_solution() const {
+  return best_solution_;
+}
+
 void Solver::Cancel() { cancelled_ = true; }
 
 absl::StatusOr<std::vector<BufferIdx>>
     Solver::ComputeIrreducibleInfeasibleSubset(const Problem& problem) {
   backtracks_ = 0;  // Reset the backtrack counter.
   cancelled_ = false;
+  best_solution_.reset();
   const absl::Time start_time = absl::Now();
   std::vector<bool> include(problem.buffers.size(), true);
   std::vector<BufferIdx> subset;
@@ -545,4 +2020,39 @@ absl::StatusOr<std::vector<BufferIdx>>
   return subset;
 }
 
+absl::StatusOr<Solution> Solver::MinimizeCapacity(const Problem& problem) {
+  backtracks_ = 0;  // Reset the backtrack counter.
+  cancelled_ = false;
+  best_solution_.reset();
+  const absl::Time start_time = absl::Now();
+  // The sweep is the same for all capacities, so it need only be done once.
+  const SweepResult sweep_result =
+      SweepWithThreads(problem, params_.sweep_threads);
+  Problem attempt = problem;
+  absl::StatusOr<Solution> best =
+      SolveWithSweepResult(attempt, sweep_result, start_time);
+  if (!best.ok()) return best;
+  Capacity lower = CalcCapacityLowerBound(problem, sweep_result);
+  Capacity upper = problem.peak(*best);  // Might be well below the capacity.
+  while (lower < upper) {
+    attempt.capacity = lower + (upper - lower) / 2;
+    auto solution = SolveWithSweepResult(attempt, sweep_result, start_time);
+    if (solution.ok()) {
+      upper = problem.peak(*solution);
+      best = std::move(solution);
+      if (!params_.hint_first) continue;
+      // Subsequent attempts can probe the layout of this solution first.
+      for (BufferIdx buffer_idx = 0; buffer_idx < attempt.buffers.size();
+          ++buffer_idx) {
+        attempt.buffers[buffer_idx].hint = best->offsets[buffer_idx];
+      }
+    } else if (absl::IsNotFound(solution.status())) {
+      lower = attempt.capacity + 1;
+    } else {
+      break;  // Out of time (or cancelled), so settle for the best so far.
+    }
+  }
+  return best;
+}
+
 }  // namespace minimalloc
@@ -19,10 +19,13 @@ limitations under the License.
 
 #include <atomic>
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "minimalloc.h"
+#include "placement.h"
+#include "sweeper.h"
 #include "absl/status/statusor.h"
 #include "absl/time/time.h"
 
@@ -37,7 +40,18 @@ using StaticPreorderingParam = bool;
 using DynamicDecompositionParam = bool;
 using MonotonicFloorParam = bool;
 using HatlessPruningParam = bool;
-using PreorderingHeuristic = std::string;
+using ParallelPortfolioParam = bool;
+using SearchThreadsParam = int;
+using PartitionThreadsParam = int;
+using SweepThreadsParam = int;
+using HintFirstParam = bool;
+using TranspositionBytesParam = int64_t;
+using RandomizedRestartsParam = bool;
+using LubyRestartsParam = bool;
+using AnytimeParam = bool;
+using SeedParam = uint64_t;
+using LnsBuffersParam = int;
+using GreedyHeuristic = std::string;
 
 // Various settings that enable / disable certain advanced search & inference
 // techniques (for benchmarking) that are employed by the solver.  Unless
@@ -80,29 +94,80 @@ struct SolverParams {
   // The static preordering heuristics to attempt.
   std::vector<PreorderingHeuristic> preordering_heuristics =
       {"WAT", "TAW", "TWA"};
-};
 
-// Data used to help establish a static preordering of buffers.
-struct PreorderData {
-  Area area;  // The total area (i.e., space x time) consumed by this buffer.
-  TimeValue lower;  // When does the buffer start?
-  uint64_t overlaps;  // The number of pairwise overlaps with other buffers.
-  int sections;  // The number of sections spanned by this buffer.
-  int64_t size;  // The size of the buffer.
-  int total;  // The (maximum) total sum in any of this buffer's sections.
-  TimeValue upper;  // When does the buffer end?
-  int64_t width;  // The width of this buffer's lifespan.
-  BufferIdx buffer_idx;  // An index into a Problem's list of buffers.
+  // Attempts each preordering heuristic concurrently (on its own thread) rather
+  // than in round robin fashion; the first to finish cancels the others.
+  ParallelPortfolioParam parallel_portfolio = false;
+
+  // The number of threads that cooperatively search each partition, stealing
+  // unexplored branches from one another.
+  SearchThreadsParam search_threads = 1;
+
+  // The number of threads used to solve independent partitions (including any
+  // discovered via dynamic decomposition, unless found while several search
+  // threads share a partition) concurrently.
+  PartitionThreadsParam partition_threads = 1;
+
+  // The number of threads used to sweep the problem (i.e., to calculate its
+  // sections, partitions, and overlaps) before the search begins.
+  SweepThreadsParam sweep_threads = 1;
+
+  // Explores any buffer that may be placed at its hinted offset before the
+  // other candidates, so that a (mostly) valid set of hints is found quickly.
+  // Since the candidates are then re-sorted at each search node, this forgoes
+  // the incremental ordering of large partitions.
+  HintFirstParam hint_first = false;
+
+  // The memory budget (in bytes) for recording the outcomes of sub-partitions
+  // found via dynamic decomposition, so that a sub-partition that recurs in
+  // the same state (e.g., after backtracking elsewhere) isn't searched again.
+  // A budget of zero (the default) disables this.
+  TranspositionBytesParam transposition_bytes = 0;
+
+  // Restarts the search under a schedule of node limits (in units of twice the
+  // problem's buffer count), trying every preordering heuristic at each limit
+  // and breaking ties in the orderings randomly after the first round.  Unlike
+  // round robin, partitions that have been solved aren't searched again.
+  RandomizedRestartsParam randomized_restarts = false;
+
+  // Follows the Luby sequence (1, 1, 2, 1, 1, 2, 4, ...) of node limits when
+  // restarting, rather than doubling the limit each time.
+  LubyRestartsParam luby_restarts = false;
+
+  // Seeds the random tie-breaking of randomized restarts (for reproducibility).
+  SeedParam seed = 0;
+
+  // Constructs a solution greedily before searching (by following the first
+  // branch of the search, ignoring the capacity), and then searches beneath the
+  // peak of the best solution found so far, stepping down toward the capacity.
+  // Should the search time out, the best solution found so far (i.e., the one
+  // with the lowest peak, even if it exceeds the capacity) remains available;
+  // see Solver::get_best_solution.
+  AnytimeParam anytime = false;
+
+  // The greedy placements attempted by the HeuristicSolver, which keeps the one
+  // with the lowest peak: "size" and "conflict" place buffers (in decreasing
+  // order of size or overlap count, respectively) at the lowest offset where
+  // each fits, whereas "skyline" repeatedly places whichever buffer may sit
+  // lowest atop those already placed (following the first preordering
+  // heuristic).
+  std::vector<GreedyHeuristic> greedy_heuristics =
+      {"size", "conflict", "skyline"};
+
+  // The time spent by the HeuristicSolver lowering the peak of its solution via
+  // large neighborhood search, i.e., by repeatedly freeing a neighborhood of
+  // buffers (holding the rest in place) and solving it exactly.  Neighborhoods
+  // alternate between connected overlapping buffers and those nearest in time.
+  absl::Duration lns_timeout = absl::ZeroDuration();
+
+  // The number of buffers freed in each neighborhood.
+  LnsBuffersParam lns_buffers = 32;
 };
 
-class PreorderingComparator {
- public:
-  explicit PreorderingComparator(const PreorderingHeuristic& h);
-  bool operator()(const PreorderData& a, const PreorderData& b) const;
-
- private:
-  PreorderingHeuristic preordering_heuristic_;
-};
+// Returns a capacity below which no solution can exist, namely the largest sum
+// of sizes in any section (or the height of any buffer with a fixed offset).
+Capacity CalcCapacityLowerBound(const Problem& problem,
+                                const SweepResult& sweep_result);
 
 class Solver {
  public:
@@ -114,6 +179,11 @@ class Solver {
   // Returns the number of backtracks in the solver's latest invocation.
   int64_t get_backtracks() const;
 
+  // Returns the solution with the lowest peak found in the solver's latest
+  // invocation (in anytime mode), which may exceed the problem's capacity if
+  // nothing better was found in time.
+  const std::optional<Solution>& get_best_solution() const;
+
   // Cancels search.
   void Cancel();
 
@@ -121,12 +191,28 @@ class Solver {
   absl::StatusOr<std::vector<BufferIdx>> ComputeIrreducibleInfeasibleSubset(
       const Problem& problem);
 
+  // Finds a solution with the smallest possible peak memory usage, treating the
+  // problem's capacity as an upper bound.  Bisects between a lower bound (e.g.,
+  // the largest total size of any section) and the peak of the best solution
+  // found so far, reusing a single sweep.  If the timeout elapses, the best
+  // solution found so far is returned.
+  absl::StatusOr<Solution> MinimizeCapacity(const Problem& problem);
+
  protected:
   virtual absl::StatusOr<Solution> SolveWithStartTime(const Problem& problem,
                                                       absl::Time start_time);
 
+  // Solves the problem using a previously computed sweep result.
+  absl::StatusOr<Solution> SolveWithSweepResult(const Problem& problem,
+                                                const SweepResult& sweep_result,
+                                                absl::Time start_time);
+
+  // Keeps the given solution if it has a lower peak than the best one so far.
+  void UpdateBestSolution(const Problem& problem, Solution solution);
+
   const SolverParams params_;
   int64_t backtracks_ = 0;  // A counter that maintains backtrack count.
+  std::optional<Solution> best_solution_;  // Only maintained in anytime mode.
   std::atomic<bool> cancelled_ = false;
 };
 
@@ -17,12 +17,13 @@ limitations under the License.
 #include "sweeper.h"
 
 #include <algorithm>
-#include <deque>
+#include <cstdint>
+#include <functional>
 #include <optional>
 #include <vector>
 
 #include "absl/container/btree_set.h"
-#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 #include "minimalloc.h"
 
 namespace minimalloc {
@@ -40,6 +41,17 @@ bool SweepPoint::operator<(const SweepPoint& x) const {
   return buffer_idx < x.buffer_idx;
 }
 
+Sections::Sections(
+    std::initializer_list<std::initializer_list<BufferIdx>> sections) {
+  for (const std::initializer_list<BufferIdx>& buffer_idxs : sections) {
+    push_back(buffer_idxs);
+  }
+}
+
+bool Sections::operator==(const Sections& x) const {
+  return buffer_idxs_ == x.buffer_idxs_ && ends_ == x.ends_;
+}
+
 bool SectionSpan::operator==(const SectionSpan& x) const {
   return section_range == x.section_range && window == x.window;
 }
@@ -69,9 +81,26 @@ bool SweepResult::operator==(const SweepResult& x) const {
          buffer_data == x.buffer_data;
 }
 
-// For a given problem, places all start & end times into a list sorted by time
-// value, then point type, then buffer index.  For a buffer with gaps, there are
-// six *potential* points of interest:
+namespace {
+
+// Problems with fewer buffers than this aren't worth sweeping concurrently, and
+// concurrent sweeps give each shard (or chunk of buffers) at least this many.
+constexpr BufferIdx kMinShardBuffers = 4096;
+
+// The most shards (or chunks of buffers) that a concurrent sweep divides into.
+constexpr int kMaxShards = 64;
+
+// Invokes fn(0), ..., fn(n - 1), concurrently if a thread pool is available.
+void ForEach(ThreadPool* pool, int n, const std::function<void(int)>& fn) {
+  if (pool) {
+    pool->ParallelFor(n, fn);
+  } else {
+    for (int idx = 0; idx < n; ++idx) fn(idx);
+  }
+}
+
+// Appends the points of a single buffer (in no particular order).  For a buffer
+// with gaps, there are six *potential* points of interest:
 //
 //   A        BC       DE        F
 //             |-------|
@@ -80,74 +109,190 @@ bool SweepResult::operator==(const SweepResult& x) const {
 //
 // Point 'A' may not need to be created if it's co-occurrent with point 'B',
 // points 'C' and 'D' may not need to be created unless there's a window, etc.
-std::vector<SweepPoint> CreatePoints(const Problem& problem) {
-  std::vector<SweepPoint> all_points;
-  all_points.reserve(problem.buffers.size() * 2);  // Reserve 2 spots per buffer
-  for (auto buffer_idx = 0; buffer_idx < problem.buffers.size(); ++buffer_idx) {
-    const Buffer& buffer = problem.buffers[buffer_idx];
-    const Lifespan& lifespan = buffer.lifespan;
-    const Window window = {0, buffer.size};
-    std::deque<SweepPoint> points;
-    absl::flat_hash_set<TimeValue> leftTimes, rightTimes;
-    // Insert left & right endpoints for all *windowed* gaps.
-    for (const Gap& gap : buffer.gaps) {
-      if (!gap.window) continue;
-      points.push_back({buffer_idx, gap.lifespan.lower(), kLeft, *gap.window});
-      points.push_back({buffer_idx, gap.lifespan.upper(), kRight, *gap.window});
-      leftTimes.insert(gap.lifespan.lower());
-      rightTimes.insert(gap.lifespan.upper());
-    }
-    // If needed, insert new points for the buffer's start & end times.
-    if (points.empty() || points.front().time_value != lifespan.lower()) {
-      points.push_front({buffer_idx, lifespan.lower(), kLeft, window});
-    }
-    if (points.empty() || points.back().time_value != lifespan.upper()) {
-      points.push_back({buffer_idx, lifespan.upper(), kRight, window});
-    }
-    // Mark the endpoints.
-    points.front().endpoint = points.back().endpoint = true;
-    rightTimes.insert(lifespan.lower());
-    leftTimes.insert(lifespan.upper());
-    // Insert left & right endpoints for all *non-windowed* gaps.
-    for (const Gap& gap : buffer.gaps) {
-      if (gap.window) continue;
-      if (!rightTimes.contains(gap.lifespan.lower())) {
-        points.push_back({buffer_idx, gap.lifespan.lower(), kRight, window});
-        rightTimes.insert(gap.lifespan.lower());
-      }
-      if (!leftTimes.contains(gap.lifespan.upper())) {
-        points.push_back({buffer_idx, gap.lifespan.upper(), kLeft, window});
-        leftTimes.insert(gap.lifespan.upper());
-      }
-      leftTimes.insert(gap.lifespan.lower());
-      rightTimes.insert(gap.lifespan.upper());
+void AppendPoints(const Problem& problem, BufferIdx buffer_idx,
+                  std::vector<SweepPoint>& points) {
+  const Buffer& buffer = problem.buffers[buffer_idx];
+  const Lifespan& lifespan = buffer.lifespan;
+  const Window window = {0, buffer.size};
+  if (buffer.gaps.empty()) {  // The common case needs no bookkeeping at all.
+    points.push_back({buffer_idx, lifespan.lower(), kLeft, window, true});
+    if (lifespan.lower() != lifespan.upper()) {
+      points.push_back({buffer_idx, lifespan.upper(), kRight, window, true});
     }
-    // Insert left & right endpoints for any implicitly active buffer sections.
-    for (const Gap& gap : buffer.gaps) {
-      if (!rightTimes.contains(gap.lifespan.lower())) {
-        points.push_back({buffer_idx, gap.lifespan.lower(), kRight, window});
-      }
-      if (!leftTimes.contains(gap.lifespan.upper())) {
-        points.push_back({buffer_idx, gap.lifespan.upper(), kLeft, window});
-      }
+    return;
+  }
+  // Gaps are few, so times are kept in small inline lists rather than sets.
+  absl::InlinedVector<TimeValue, 8> leftTimes, rightTimes;
+  const auto contains = [](const absl::InlinedVector<TimeValue, 8>& times,
+                           TimeValue time_value) {
+    return std::find(times.begin(), times.end(), time_value) != times.end();
+  };
+  // Insert left & right endpoints for all *windowed* gaps, preceded (and
+  // followed) by points for the buffer's start (and end) times if needed.
+  const auto first_windowed =
+      std::find_if(buffer.gaps.begin(), buffer.gaps.end(),
+                   [](const Gap& gap) { return gap.window.has_value(); });
+  const size_t front = points.size();
+  if (first_windowed == buffer.gaps.end() ||
+      first_windowed->lifespan.lower() != lifespan.lower()) {
+    points.push_back({buffer_idx, lifespan.lower(), kLeft, window});
+  }
+  for (const Gap& gap : buffer.gaps) {
+    if (!gap.window) continue;
+    points.push_back({buffer_idx, gap.lifespan.lower(), kLeft, *gap.window});
+    points.push_back({buffer_idx, gap.lifespan.upper(), kRight, *gap.window});
+    leftTimes.push_back(gap.lifespan.lower());
+    rightTimes.push_back(gap.lifespan.upper());
+  }
+  if (points.back().time_value != lifespan.upper()) {
+    points.push_back({buffer_idx, lifespan.upper(), kRight, window});
+  }
+  // Mark the endpoints.
+  points[front].endpoint = points.back().endpoint = true;
+  rightTimes.push_back(lifespan.lower());
+  leftTimes.push_back(lifespan.upper());
+  // Insert left & right endpoints for all *non-windowed* gaps.
+  for (const Gap& gap : buffer.gaps) {
+    if (gap.window) continue;
+    if (!contains(rightTimes, gap.lifespan.lower())) {
+      points.push_back({buffer_idx, gap.lifespan.lower(), kRight, window});
+      rightTimes.push_back(gap.lifespan.lower());
+    }
+    if (!contains(leftTimes, gap.lifespan.upper())) {
+      points.push_back({buffer_idx, gap.lifespan.upper(), kLeft, window});
+      leftTimes.push_back(gap.lifespan.upper());
+    }
+    leftTimes.push_back(gap.lifespan.lower());
+    rightTimes.push_back(gap.lifespan.upper());
+  }
+  // Insert left & right endpoints for any implicitly active buffer sections.
+  for (const Gap& gap : buffer.gaps) {
+    if (!contains(rightTimes, gap.lifespan.lower())) {
+      points.push_back({buffer_idx, gap.lifespan.lower(), kRight, window});
+    }
+    if (!contains(leftTimes, gap.lifespan.upper())) {
+      points.push_back({buffer_idx, gap.lifespan.upper(), kLeft, window});
     }
-    // Add these into the list of all points.
-    all_points.insert(all_points.end(), points.begin(), points.end());
   }
-  std::sort(all_points.begin(), all_points.end());
-  return all_points;
 }
 
-SweepResult Sweep(const Problem& problem) {
-  SweepResult result;
-  const auto num_buffers = problem.buffers.size();
-  const std::vector<SweepPoint> points = CreatePoints(problem);
-  Section actives, alive;
+// Returns an upper bound on the number of points created for the given buffers.
+size_t MaxPoints(const Problem& problem, BufferIdx begin, BufferIdx end) {
+  size_t max_points = 0;
+  for (BufferIdx buffer_idx = begin; buffer_idx < end; ++buffer_idx) {
+    max_points += 2 + 4 * problem.buffers[buffer_idx].gaps.size();
+  }
+  return max_points;
+}
+
+// Sorts points (listed in order of buffer index) by time value, then point
+// type, then buffer index.  Whenever the time values are dense enough, this is
+// a radix sort with a single counting pass over (time value, point type) pairs:
+// as the pass is stable, points sharing a pair remain in buffer index order.
+// Otherwise (or for short lists), falls back to a comparison sort.
+void SortPoints(std::vector<SweepPoint>& points) {
+  constexpr size_t kMinRadixPoints = 1024;
+  if (points.size() < kMinRadixPoints) {
+    std::sort(points.begin(), points.end());
+    return;
+  }
+  TimeValue min_time = points.front().time_value, max_time = min_time;
+  for (const SweepPoint& point : points) {
+    min_time = std::min(min_time, point.time_value);
+    max_time = std::max(max_time, point.time_value);
+  }
+  // Use no more buckets (i.e., two per time value) than there are points.
+  const uint64_t time_range =
+      static_cast<uint64_t>(max_time) - static_cast<uint64_t>(min_time);
+  if (time_range >= points.size() / 2) {
+    std::sort(points.begin(), points.end());
+    return;
+  }
+  const auto bucket = [min_time](const SweepPoint& point) {
+    return (point.time_value - min_time) * 2 + point.point_type;
+  };
+  std::vector<size_t> offsets((time_range + 1) * 2 + 1);
+  for (const SweepPoint& point : points) ++offsets[bucket(point) + 1];
+  for (size_t idx = 1; idx < offsets.size(); ++idx) {
+    offsets[idx] += offsets[idx - 1];
+  }
+  std::vector<SweepPoint> sorted_points(points.size());
+  for (const SweepPoint& point : points) {
+    sorted_points[offsets[bucket(point)]++] = point;
+  }
+  points = std::move(sorted_points);
+}
+
+// The buffers that are alive at some point during a sweep, kept in dense lists
+// for quick iteration.  "Plain" buffers (with nonempty lifespans and no gaps)
+// are listed separately, since any two of them that are alive at once overlap
+// by their full sizes.  Positions are kept in a vector that is shared between
+// concurrent sweeps (whose buffers are disjoint).
+class AliveBuffers {
+ public:
+  explicit AliveBuffers(std::vector<int64_t>& positions)
+      : positions_(positions) {}
+
+  bool empty() const { return plain_.empty() && gapped_.empty(); }
+  const std::vector<BufferIdx>& plain() const { return plain_; }
+  const std::vector<BufferIdx>& gapped() const { return gapped_; }
+
+  void insert(BufferIdx buffer_idx, bool plain) {
+    if (positions_[buffer_idx] != -1) return;
+    std::vector<BufferIdx>& buffer_idxs = plain ? plain_ : gapped_;
+    positions_[buffer_idx] = buffer_idxs.size();
+    buffer_idxs.push_back(buffer_idx);
+  }
+
+  void erase(BufferIdx buffer_idx, bool plain) {
+    if (positions_[buffer_idx] == -1) return;
+    std::vector<BufferIdx>& buffer_idxs = plain ? plain_ : gapped_;
+    positions_[buffer_idxs.back()] = positions_[buffer_idx];
+    buffer_idxs[positions_[buffer_idx]] = buffer_idxs.back();
+    buffer_idxs.pop_back();
+    positions_[buffer_idx] = -1;
+  }
+
+ private:
+  std::vector<BufferIdx> plain_;
+  std::vector<BufferIdx> gapped_;
+  std::vector<int64_t>& positions_;  // Within either list (or -1 if absent).
+};
+
+// Per-buffer state of a sweep, which concurrent sweeps share (as each buffer
+// is swept by exactly one of them).
+struct SweepState {
+  explicit SweepState(const Problem& problem)
+      : plain(problem.buffers.size()),
+        positions(problem.buffers.size(), -1),
+        section_starts(problem.buffers.size(), -1) {
+    for (BufferIdx buffer_idx = 0; buffer_idx < problem.buffers.size();
+        ++buffer_idx) {
+      const Buffer& buffer = problem.buffers[buffer_idx];
+      plain[buffer_idx] = buffer.gaps.empty() &&
+                          buffer.lifespan.lower() < buffer.lifespan.upper();
+    }
+  }
+
+  std::vector<bool> plain;
+  std::vector<int64_t> positions;
+  // A reverse index (from buffers to sections) for quick lookup.
+  std::vector<SectionIdx> section_starts;
+};
+
+// Sweeps a run of sorted points that begins a new partition, recording its
+// sections and partitions into 'result', and the data of its buffers into
+// 'buffer_data' (with section indices relative to the run's first section).
+void SweepPoints(const Problem& problem, absl::Span<const SweepPoint> points,
+                 SweepState& state, SweepResult& result,
+                 std::vector<BufferData>& buffer_data) {
+  // Actives are kept in order so that each new section is stored sorted.
+  absl::btree_set<BufferIdx> actives;
+  AliveBuffers alive(state.positions);
+  const std::vector<bool>& plain = state.plain;
+  std::vector<SectionIdx>& buffer_idx_to_section_start = state.section_starts;
   TimeValue last_section_time = -1;
   SectionIdx last_section_idx = 0;
-  // Create a reverse index (from buffers to sections) for quick lookup.
-  result.buffer_data.resize(num_buffers);
-  std::vector<SectionIdx> buffer_idx_to_section_start(num_buffers, -1);
   for (const SweepPoint& point : points) {
     const BufferIdx buffer_idx = point.buffer_idx;
     const Buffer& buffer = problem.buffers[buffer_idx];
@@ -160,12 +305,12 @@ SweepResult Sweep(const Problem& problem) {
       }
       // If it's a right endpoint, remove it from the set of active buffers.
       actives.erase(buffer_idx);
-      if (point.endpoint) alive.erase(buffer_idx);
+      if (point.endpoint) alive.erase(buffer_idx, plain[buffer_idx]);
       const SectionRange section_range =
           {buffer_idx_to_section_start[buffer_idx],
            (int)result.sections.size()};
       const SectionSpan section_span = {section_range, point.window};
-      result.buffer_data[buffer_idx].section_spans.push_back(section_span);
+      buffer_data[buffer_idx].section_spans.push_back(section_span);
       // If the alives are empty, the span of this partition is now known.
       if (alive.empty()) {
         result.partitions.back().section_range =
@@ -179,26 +324,177 @@ SweepResult Sweep(const Problem& problem) {
       // Record any overlaps, and then add this buffer to the set of actives.
       if (point.endpoint) {
         result.partitions.back().buffer_idxs.push_back(buffer_idx);
-        for (auto alive_idx : alive) {
+        std::vector<Overlap>& overlaps = buffer_data[buffer_idx].overlaps;
+        const auto add_overlaps = [&](BufferIdx alive_idx) {
           const Buffer& alive = problem.buffers[alive_idx];
           auto alive_effective_size = alive.effective_size(buffer);
           if (alive_effective_size) {
-            result.buffer_data[alive_idx].overlaps.insert(
+            buffer_data[alive_idx].overlaps.push_back(
                 {buffer_idx, *alive_effective_size});
           }
           auto effective_size = buffer.effective_size(alive);
-          if (effective_size) {
-            result.buffer_data[buffer_idx].overlaps.insert({alive_idx,
-                                                            *effective_size});
+          if (effective_size) overlaps.push_back({alive_idx, *effective_size});
+        };
+        if (plain[buffer_idx]) {
+          // Plain pairs overlap in full, so their sizes are emitted in bulk.
+          for (const BufferIdx alive_idx : alive.plain()) {
+            buffer_data[alive_idx].overlaps.push_back(
+                {buffer_idx, problem.buffers[alive_idx].size});
+          }
+          overlaps.reserve(overlaps.size() + alive.plain().size());
+          for (const BufferIdx alive_idx : alive.plain()) {
+            overlaps.push_back({alive_idx, buffer.size});
           }
+        } else {
+          for (const BufferIdx alive_idx : alive.plain()) {
+            add_overlaps(alive_idx);
+          }
+        }
+        for (const BufferIdx alive_idx : alive.gapped()) {
+          add_overlaps(alive_idx);
         }
       }
       actives.insert(buffer_idx);
       // Mutants OK for following line; performance tweak to prevent reinsertion
-      if (point.endpoint) alive.insert(buffer_idx);
+      if (point.endpoint) alive.insert(buffer_idx, plain[buffer_idx]);
       buffer_idx_to_section_start[buffer_idx] = result.sections.size();
     }
   }
+}
+
+// Returns the indices at which sorted points may be split into shards that can
+// be swept independently, i.e., where every buffer has ended, and the next
+// point starts a new partition.  Returns nothing if some buffer has no (or an
+// empty) lifespan, since the sweep of its points may not be self-contained.
+std::vector<size_t> FindShardBoundaries(const Problem& problem,
+                                        const std::vector<SweepPoint>& points,
+                                        size_t num_shards) {
+  std::vector<bool> active(problem.buffers.size()), alive(active);
+  int64_t num_active = 0, num_alive = 0;
+  std::vector<size_t> boundaries;
+  for (size_t idx = 0; idx < points.size(); ++idx) {
+    const SweepPoint& point = points[idx];
+    const BufferIdx buffer_idx = point.buffer_idx;
+    if (point.point_type == kLeft) {
+      if (!active[buffer_idx]) ++num_active;
+      active[buffer_idx] = true;
+      if (point.endpoint && !alive[buffer_idx]) ++num_alive;
+      if (point.endpoint) alive[buffer_idx] = true;
+      continue;
+    }
+    if (!active[buffer_idx]) return {};  // Ends before it has begun.
+    active[buffer_idx] = false;
+    --num_active;
+    if (point.endpoint && alive[buffer_idx]) --num_alive;
+    if (point.endpoint) alive[buffer_idx] = false;
+    if (num_active || num_alive || idx + 1 == points.size()) continue;
+    if (points[idx + 1].point_type != kLeft) continue;
+    // Only split once this shard has received its share of the points.
+    const size_t begin = boundaries.empty() ? 0 : boundaries.back();
+    if ((idx + 1 - begin) * num_shards >= points.size()) {
+      boundaries.push_back(idx + 1);
+    }
+  }
+  return boundaries;
+}
+
+}  // namespace
+
+// For a given problem, places all start & end times into a list sorted by time
+// value, then point type, then buffer index.  Given a thread pool, chunks of
+// buffers are handled concurrently, and their sorted points are merged.
+std::vector<SweepPoint> CreatePoints(const Problem& problem, ThreadPool* pool) {
+  const BufferIdx num_buffers = problem.buffers.size();
+  const int num_chunks = pool
+      ? std::clamp<BufferIdx>(num_buffers / kMinShardBuffers, 1, kMaxShards)
+      : 1;
+  std::vector<std::vector<SweepPoint>> runs(num_chunks);
+  ForEach(pool, num_chunks, [&](int chunk) {
+    const BufferIdx begin = num_buffers * chunk / num_chunks;
+    const BufferIdx end = num_buffers * (chunk + 1) / num_chunks;
+    std::vector<SweepPoint>& points = runs[chunk];
+    points.reserve(MaxPoints(problem, begin, end));  // Never reallocates.
+    for (BufferIdx buffer_idx = begin; buffer_idx < end; ++buffer_idx) {
+      AppendPoints(problem, buffer_idx, points);
+    }
+    SortPoints(points);
+  });
+  // Merge pairs of sorted runs (concurrently) until only one remains.
+  while (runs.size() > 1) {
+    std::vector<std::vector<SweepPoint>> merged_runs((runs.size() + 1) / 2);
+    ForEach(pool, merged_runs.size(), [&](int idx) {
+      if (2 * idx + 1 == runs.size()) {
+        merged_runs[idx] = std::move(runs[2 * idx]);
+        return;
+      }
+      const std::vector<SweepPoint>& a = runs[2 * idx];
+      const std::vector<SweepPoint>& b = runs[2 * idx + 1];
+      merged_runs[idx].resize(a.size() + b.size());
+      std::merge(a.begin(), a.end(), b.begin(), b.end(),
+                 merged_runs[idx].begin());
+    });
+    runs = std::move(merged_runs);
+  }
+  return std::move(runs.front());
+}
+
+SweepResult Sweep(const Problem& problem, ThreadPool* pool) {
+  const std::vector<SweepPoint> points = CreatePoints(problem, pool);
+  SweepState state(problem);
+  SweepResult result;
+  result.buffer_data.resize(problem.buffers.size());
+  const size_t num_shards = pool
+      ? std::clamp<size_t>(problem.buffers.size() / kMinShardBuffers, 1,
+                           kMaxShards)
+      : 1;
+  const std::vector<size_t> boundaries = num_shards > 1
+      ? FindShardBoundaries(problem, points, num_shards)
+      : std::vector<size_t>();
+  if (boundaries.empty()) {
+    SweepPoints(problem, points, state, result, result.buffer_data);
+    // Each pair of buffers is visited once above, so sorting is all that's left.
+    for (BufferData& buffer_data : result.buffer_data) {
+      std::sort(buffer_data.overlaps.begin(), buffer_data.overlaps.end());
+    }
+    return result;
+  }
+  // Sweep each shard separately, into the buffer data of the final result.
+  std::vector<SweepResult> shards(boundaries.size() + 1);
+  ForEach(pool, shards.size(), [&](int shard_idx) {
+    const size_t begin = shard_idx ? boundaries[shard_idx - 1] : 0;
+    const size_t end = shard_idx < boundaries.size() ? boundaries[shard_idx]
+                                                     : points.size();
+    SweepPoints(problem, absl::MakeConstSpan(points).subspan(begin, end - begin),
+                state, shards[shard_idx], result.buffer_data);
+  });
+  // Then stitch them together, offsetting each shard's section indices.
+  std::vector<SectionIdx> section_bases(shards.size());
+  for (size_t shard_idx = 0; shard_idx < shards.size(); ++shard_idx) {
+    const SweepResult& shard = shards[shard_idx];
+    const SectionIdx base = result.sections.size();
+    section_bases[shard_idx] = base;
+    for (SectionIdx s_idx = 0; s_idx < shard.sections.size(); ++s_idx) {
+      result.sections.push_back(shard.sections[s_idx]);
+    }
+    for (const Partition& partition : shard.partitions) {
+      result.partitions.push_back(partition);
+      SectionRange& range = result.partitions.back().section_range;
+      range = {range.lower() + base, range.upper() + base};
+    }
+  }
+  ForEach(pool, shards.size(), [&](int shard_idx) {
+    const SectionIdx base = section_bases[shard_idx];
+    for (const Partition& partition : shards[shard_idx].partitions) {
+      for (const BufferIdx buffer_idx : partition.buffer_idxs) {
+        BufferData& buffer_data = result.buffer_data[buffer_idx];
+        for (SectionSpan& section_span : buffer_data.section_spans) {
+          SectionRange& range = section_span.section_range;
+          range = {range.lower() + base, range.upper() + base};
+        }
+        std::sort(buffer_data.overlaps.begin(), buffer_data.overlaps.end());
+      }
+    }
+  });
   return result;
 }
 
@@ -218,4 +514,10 @@ std::vector<CutCount> SweepResult::CalculateCuts() const {
   return cuts;
 }
 
+SweepResult SweepWithThreads(const Problem& problem, int num_threads) {
+  if (num_threads <= 1) return Sweep(problem);
+  ThreadPool thread_pool(num_threads - 1);
+  return Sweep(problem, &thread_pool);
+}
+
 }  // namespace minimalloc
@@ -17,11 +17,13 @@ limitations under the License.
 #ifndef MINIMALLOC_SRC_SWEEPER_H_
 #define MINIMALLOC_SRC_SWEEPER_H_
 
+#include <cstddef>
+#include <initializer_list>
 #include <vector>
 
 #include "minimalloc.h"
-#include "absl/container/btree_set.h"
-#include "absl/container/flat_hash_set.h"
+#include "thread_pool.h"
+#include "absl/types/span.h"
 
 namespace minimalloc {
 
@@ -71,8 +73,43 @@ struct SectionSpan {
 //             |======|======|======|======|======|======|======|======|======|
 //   sections: |     sec0    |     sec1    | sec2 |            sec3           |
 //             |======|======|======|======|======|======|======|======|======|
-
-using Section = absl::flat_hash_set<BufferIdx>;
+//
+// Rather than keeping a separate set for each section, the buffers of every
+// section are stored back-to-back in a single array (in ascending order within
+// each section), alongside the position where each section ends:
+//
+//     buffer_idxs = {0, 2, 1, 2, 2, 3}
+//     ends        = {2, 4, 5, 6}
+
+class Sections {
+ public:
+  Sections() = default;
+  Sections(std::initializer_list<std::initializer_list<BufferIdx>> sections);
+
+  // Appends a section comprising the given buffers (in ascending order).
+  template <typename BufferIdxs>
+  void push_back(const BufferIdxs& buffer_idxs) {
+    buffer_idxs_.insert(buffer_idxs_.end(), buffer_idxs.begin(),
+                        buffer_idxs.end());
+    ends_.push_back(buffer_idxs_.size());
+  }
+
+  // Returns the buffers that are active in the given section.
+  absl::Span<const BufferIdx> operator[](SectionIdx s_idx) const {
+    const size_t begin = s_idx > 0 ? ends_[s_idx - 1] : 0;
+    return absl::MakeConstSpan(buffer_idxs_.data() + begin,
+                               ends_[s_idx] - begin);
+  }
+
+  size_t size() const { return ends_.size(); }
+  bool empty() const { return ends_.empty(); }
+
+  bool operator==(const Sections& x) const;
+
+ private:
+  std::vector<BufferIdx> buffer_idxs_;
+  std::vector<size_t> ends_;
+};
 
 // Partitions store various preprocessed attributes for a subset of a Problem's
 // buffers.  Partitions are mutually exclusive -- that is, any buffer belongs to
@@ -131,8 +168,9 @@ struct BufferData {
   // given section does not necessarily mean it is live for the full duration.
   std::vector<SectionSpan> section_spans;
 
-  // Contains a set of buffers that overlap at some point in time with this one.
-  absl::btree_set<Overlap> overlaps;
+  // The buffers that overlap at some point in time with this one, sorted by
+  // buffer index and stored contiguously (as it's iterated at every placement).
+  std::vector<Overlap> overlaps;
 
   bool operator==(const BufferData& x) const;
 };
@@ -144,7 +182,7 @@ struct BufferData {
 struct SweepResult {
   // Cross sections of buffers that are "active" at particular moments in the
   // schedule.
-  std::vector<Section> sections;
+  Sections sections;
 
   // The list of (mutually-exclusive) partitions over a problem's buffers.
   std::vector<Partition> partitions;
@@ -172,13 +210,20 @@ struct SweepPoint {
 };
 
 // For a given problem, places all start & end times into a list sorted by time
-// value, then point type, then buffer index.
-std::vector<SweepPoint> CreatePoints(const Problem& problem);
+// value, then point type, then buffer index.  If a thread pool is provided, the
+// points are created and sorted concurrently.
+std::vector<SweepPoint> CreatePoints(const Problem& problem,
+                                     ThreadPool* pool = nullptr);
 
 // Maintains an "active" set of buffers to determine disjoint partitions.  For
 // each partition, records the list of buffers + pairwise overlaps + unique
-// cross sections.
-SweepResult Sweep(const Problem& problem);
+// cross sections.  If a thread pool is provided, the timeline is split between
+// partitions into shards that are swept concurrently; the result is the same.
+SweepResult Sweep(const Problem& problem, ThreadPool* pool = nullptr);
+
+// Sweeps the problem, using a thread pool of its own if more than one thread is
+// requested.
+SweepResult SweepWithThreads(const Problem& problem, int num_threads);
 
 }  // namespace minimalloc
 
@@ -0,0 +1,81 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace minimalloc {
+
+ThreadPool::ThreadPool(int num_threads) {
+  threads_.reserve(num_threads);
+  for (int thread_idx = 0; thread_idx < num_threads; ++thread_idx) {
+    threads_.emplace_back([this]() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!stopping_) {
+        if (!RunPending(lock, /*batch=*/nullptr)) cv_.wait(lock);
+      }
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+}
+
+void ThreadPool::ParallelFor(int n, const std::function<void(int)>& fn) {
+  if (n <= 0) return;
+  // Index zero is reserved for the calling thread.
+  Batch batch = {.fn = &fn, .size = n, .next_idx = 1, .remaining = n};
+  if (n > 1) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batches_.push_back(&batch);
+  }
+  cv_.notify_all();
+  fn(0);
+  std::unique_lock<std::mutex> lock(mutex_);
+  --batch.remaining;
+  // Help out until every index of this batch has completed.
+  while (batch.remaining > 0) {
+    if (!RunPending(lock, &batch)) cv_.wait(lock);
+  }
+}
+
+bool ThreadPool::RunPending(std::unique_lock<std::mutex>& lock, Batch* batch) {
+  if (batch == nullptr || batch->next_idx >= batch->size) {
+    if (batches_.empty()) return false;
+    batch = batches_.front();
+  }
+  const int idx = batch->next_idx++;
+  if (batch->next_idx == batch->size) {
+    batches_.erase(std::find(batches_.begin(), batches_.end(), batch));
+  }
+  lock.unlock();
+  (*batch->fn)(idx);
+  lock.lock();
+  if (--batch->remaining == 0) cv_.notify_all();
+  return true;
+}
+
+}  // namespace minimalloc
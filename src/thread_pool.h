@@ -0,0 +1,70 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef MINIMALLOC_SRC_THREAD_POOL_H_
+#define MINIMALLOC_SRC_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace minimalloc {
+
+// A simple pool of threads that executes batches of work.  Any thread waiting
+// on a batch helps to execute pending work in the meantime, so work items may
+// themselves submit (and wait upon) nested batches without risk of deadlock.
+// That help may run any pending item above the waiter's own stack, so an item
+// must never block on something that only a waiting item could provide.
+class ThreadPool {
+ public:
+  // Creates a pool with the given number of background threads (in addition to
+  // any thread that happens to be waiting on a batch).
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Invokes fn(0), fn(1), ..., fn(n - 1), possibly concurrently, and returns
+  // once all of them have completed.  The calling thread always invokes fn(0)
+  // itself, so that it may safely make use of any thread-local state.
+  void ParallelFor(int n, const std::function<void(int)>& fn);
+
+ private:
+  struct Batch {
+    const std::function<void(int)>* fn;
+    int size = 0;
+    int next_idx = 0;  // The next index to be claimed.
+    int remaining = 0;  // The number of indices that have yet to complete.
+  };
+
+  // Claims and invokes a single pending index (preferring those of 'batch'),
+  // returning false if nothing is pending.  The lock must be held on entry.
+  bool RunPending(std::unique_lock<std::mutex>& lock, Batch* batch);
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Batch*> batches_;  // Batches with unclaimed indices.
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace minimalloc
+
+#endif  // MINIMALLOC_SRC_THREAD_POOL_H_
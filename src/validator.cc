@@ -16,12 +16,202 @@ limitations under the License.
 
 #include "validator.h"
 
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <limits>
+#include <numeric>
 #include <optional>
+#include <queue>
+#include <utility>
 #include <vector>
 
 #include "minimalloc.h"
 
 namespace minimalloc {
+namespace {
+
+// Problems with fewer buffers than this aren't worth validating concurrently,
+// and concurrent validation gives each shard at least this many arrivals.
+constexpr size_t kMinShardBuffers = 4096;
+
+// The most shards that concurrent validation divides the timeline into.
+constexpr size_t kMaxShards = 64;
+
+// The range of offsets that a buffer might occupy at any point in time (i.e.,
+// across its full size and the windows of all its gaps).
+struct Extent {
+  Offset bottom;
+  Offset top;
+};
+
+Extent GetExtent(const Buffer& buffer, Offset offset) {
+  Offset lower = 0, upper = buffer.size;
+  for (const Gap& gap : buffer.gaps) {
+    if (!gap.window) continue;
+    lower = std::min(lower, gap.window->lower());
+    upper = std::max(upper, gap.window->upper());
+  }
+  return {offset + lower, offset + upper};
+}
+
+// Keeps track of which buffers (among a given subset, identified by their
+// position therein) are active, and finds those whose extents intersect a given
+// extent.  Buffers are ranked by the bottoms of their extents, and a segment
+// tree over these ranks maintains the highest top of any active buffer, so that
+// subtrees without an intersecting extent are skipped.
+class ExtentTree {
+ public:
+  ExtentTree(const std::vector<Extent>& extents,
+             const std::vector<BufferIdx>& buffer_idxs)
+      : ranks_(buffer_idxs.size()), order_(buffer_idxs.size()),
+        num_leaves_(std::bit_ceil(std::max<size_t>(buffer_idxs.size(), 1))),
+        tops_(2 * num_leaves_, kInactive) {
+    std::iota(order_.begin(), order_.end(), 0);
+    std::sort(order_.begin(), order_.end(), [&](size_t a, size_t b) {
+      return extents[buffer_idxs[a]].bottom < extents[buffer_idxs[b]].bottom;
+    });
+    bottoms_.reserve(order_.size());
+    for (size_t rank = 0; rank < order_.size(); ++rank) {
+      ranks_[order_[rank]] = rank;
+      bottoms_.push_back(extents[buffer_idxs[order_[rank]]].bottom);
+    }
+  }
+
+  void Insert(size_t pos, const Extent& extent) {
+    Update(ranks_[pos], extent.top);
+  }
+
+  void Erase(size_t pos) { Update(ranks_[pos], kInactive); }
+
+  // Returns true if 'fn' returns true for the position of some active buffer
+  // whose extent intersects the given one (stopping at the first such buffer).
+  bool AnyIntersecting(const Extent& extent,
+                       const std::function<bool(size_t)>& fn) const {
+    // Only buffers whose bottoms lie below the given top are of interest.
+    const size_t limit =
+        std::lower_bound(bottoms_.begin(), bottoms_.end(), extent.top) -
+        bottoms_.begin();
+    return AnyIntersecting(1, 0, num_leaves_, limit, extent.bottom, fn);
+  }
+
+ private:
+  static constexpr Offset kInactive = std::numeric_limits<Offset>::min();
+
+  void Update(size_t rank, Offset top) {
+    size_t idx = num_leaves_ + rank;
+    tops_[idx] = top;
+    for (idx /= 2; idx > 0; idx /= 2) {
+      tops_[idx] = std::max(tops_[2 * idx], tops_[2 * idx + 1]);
+    }
+  }
+
+  bool AnyIntersecting(size_t idx, size_t lower, size_t upper, size_t limit,
+                       Offset bottom,
+                       const std::function<bool(size_t)>& fn) const {
+    if (lower >= limit || tops_[idx] <= bottom) return false;
+    if (upper - lower == 1) return fn(order_[lower]);
+    const size_t mid = (lower + upper) / 2;
+    return AnyIntersecting(2 * idx, lower, mid, limit, bottom, fn) ||
+           AnyIntersecting(2 * idx + 1, mid, upper, limit, bottom, fn);
+  }
+
+  std::vector<size_t> ranks_;  // The rank of each position, by bottom.
+  std::vector<size_t> order_;  // The position at each rank.
+  std::vector<Offset> bottoms_;  // The bottom at each rank.
+  const size_t num_leaves_;
+  std::vector<Offset> tops_;  // The highest active top within each subtree.
+};
+
+// Sweeps over buffers in order of their start times, and returns true if 'fn'
+// returns true for some pair (i, j) where buffer i started no later than j, the
+// two are alive at once, and their extents intersect.  The sweep may begin
+// partway through the timeline, with 'actives' listing the buffers that are
+// still alive when the first of 'arrivals' (sorted by start time) begins.
+bool AnyCandidatePair(const Problem& problem,
+                      const std::vector<Extent>& extents,
+                      const std::vector<BufferIdx>& actives,
+                      const std::vector<BufferIdx>& arrivals,
+                      const std::function<bool(BufferIdx, BufferIdx)>& fn) {
+  std::vector<BufferIdx> buffer_idxs = actives;
+  buffer_idxs.insert(buffer_idxs.end(), arrivals.begin(), arrivals.end());
+  ExtentTree tree(extents, buffer_idxs);
+  using Departure = std::pair<TimeValue, size_t>;
+  std::priority_queue<Departure, std::vector<Departure>, std::greater<>>
+      departures;
+  for (size_t pos = 0; pos < buffer_idxs.size(); ++pos) {
+    const BufferIdx j = buffer_idxs[pos];
+    const Lifespan& lifespan = problem.buffers[j].lifespan;
+    if (pos >= actives.size()) {
+      while (!departures.empty() &&
+             departures.top().first <= lifespan.lower()) {
+        tree.Erase(departures.top().second);
+        departures.pop();
+      }
+      const bool found = tree.AnyIntersecting(extents[j], [&](size_t i_pos) {
+        return fn(buffer_idxs[i_pos], j);
+      });
+      if (found) return true;
+    }
+    tree.Insert(pos, extents[j]);
+    departures.push({lifespan.upper(), pos});
+  }
+  return false;
+}
+
+// Returns a violation if two buffers overlap in both space and time.
+std::optional<Violation> FindOverlap(const Problem& problem,
+                                     const Solution& solution,
+                                     BufferIdx i, BufferIdx j) {
+  if (i > j) std::swap(i, j);
+  const Buffer& buffer_i = problem.buffers[i];
+  const Buffer& buffer_j = problem.buffers[j];
+  const Offset offset_i = solution.offsets[i];
+  const Offset offset_j = solution.offsets[j];
+  const auto buffer_i_size = buffer_i.effective_size(buffer_j);
+  const auto buffer_j_size = buffer_j.effective_size(buffer_i);
+  if (!buffer_i_size || offset_i + *buffer_i_size <= offset_j) return {};
+  if (!buffer_j_size || offset_j + *buffer_j_size <= offset_i) return {};
+  return Violation{
+      .result = kBadOverlap,
+      .buffer_idx = i,
+      .other_buffer_idx = j,
+      .lifespan = {std::max(buffer_i.lifespan.lower(),
+                            buffer_j.lifespan.lower()),
+                   std::min(buffer_i.lifespan.upper(),
+                            buffer_j.lifespan.upper())},
+      .offsets = {std::max(offset_i, offset_j),
+                  std::min(offset_i + *buffer_i_size,
+                           offset_j + *buffer_j_size)}};
+}
+
+// Returns the extent of each buffer, along with all buffers sorted by start time.
+std::pair<std::vector<Extent>, std::vector<BufferIdx>> PrepareSweep(
+    const Problem& problem, const Solution& solution) {
+  const auto num_buffers = problem.buffers.size();
+  std::vector<Extent> extents;
+  extents.reserve(num_buffers);
+  for (BufferIdx buffer_idx = 0; buffer_idx < num_buffers; ++buffer_idx) {
+    extents.push_back(GetExtent(problem.buffers[buffer_idx],
+                                solution.offsets[buffer_idx]));
+  }
+  std::vector<BufferIdx> buffer_idxs(num_buffers);
+  std::iota(buffer_idxs.begin(), buffer_idxs.end(), 0);
+  std::sort(buffer_idxs.begin(), buffer_idxs.end(),
+            [&](BufferIdx a, BufferIdx b) {
+              return problem.buffers[a].lifespan.lower() <
+                     problem.buffers[b].lifespan.lower();
+            });
+  return {std::move(extents), std::move(buffer_idxs)};
+}
+
+}  // namespace
+
+bool Violation::operator==(const Violation& x) const {
+  return result == x.result && buffer_idx == x.buffer_idx &&
+         other_buffer_idx == x.other_buffer_idx && lifespan == x.lifespan &&
+         offsets == x.offsets && expected == x.expected;
+}
 
 ValidationResult Validate(const Problem& problem, const Solution& solution) {
   // Check that the number of buffers matches the number of offsets.
@@ -35,21 +225,93 @@ ValidationResult Validate(const Problem& problem, const Solution& solution) {
     if (offset + buffer.size > problem.capacity) return kBadOffset;
     if (offset % buffer.alignment != 0) return kBadAlignment;
   }
-  // Check that no two buffers overlap in both space and time, the O(n^2) way.
-  for (BufferIdx i = 0; i < problem.buffers.size(); ++i) {
-    const Buffer& buffer_i = problem.buffers[i];
-    const Offset offset_i = solution.offsets[i];
-    for (BufferIdx j = i + 1; j < problem.buffers.size(); ++j) {
-      const Buffer& buffer_j = problem.buffers[j];
-      const Offset offset_j = solution.offsets[j];
-      const auto buffer_i_size = buffer_i.effective_size(buffer_j);
-      const auto buffer_j_size = buffer_j.effective_size(buffer_i);
-      if (!buffer_i_size || offset_i + *buffer_i_size <= offset_j) continue;
-      if (!buffer_j_size || offset_j + *buffer_j_size <= offset_i) continue;
-      return kBadOverlap;
+  // Check that no two buffers overlap in both space and time.  Buffers are swept
+  // in order of their start times; only those still active whose extents
+  // intersect are candidates for the more thorough (pairwise) check.
+  const auto [extents, buffer_idxs] = PrepareSweep(problem, solution);
+  const bool overlaps = AnyCandidatePair(problem, extents, {}, buffer_idxs,
+      [&](BufferIdx i, BufferIdx j) {
+        return FindOverlap(problem, solution, i, j).has_value();
+      });
+  return overlaps ? kBadOverlap : kGood;
+}
+
+std::vector<Violation> ValidateDetailed(const Problem& problem,
+                                        const Solution& solution,
+                                        ThreadPool* pool) {
+  if (problem.buffers.size() != solution.offsets.size()) {
+    return {{.result = kBadSolution}};
+  }
+  std::vector<Violation> violations;
+  for (auto buffer_idx = 0; buffer_idx < problem.buffers.size(); ++buffer_idx) {
+    const Buffer& buffer = problem.buffers[buffer_idx];
+    const Offset offset = solution.offsets[buffer_idx];
+    const Violation violation = {.buffer_idx = buffer_idx,
+                                 .lifespan = buffer.lifespan,
+                                 .offsets = {offset, offset + buffer.size}};
+    if (buffer.offset && *buffer.offset != offset) {
+      violations.push_back(violation);
+      violations.back().result = kBadFixed;
+      violations.back().expected = *buffer.offset;
     }
+    if (offset < 0 || offset + buffer.size > problem.capacity) {
+      violations.push_back(violation);
+      violations.back().result = kBadOffset;
+      violations.back().expected = problem.capacity;
+    }
+    if (offset % buffer.alignment != 0) {
+      violations.push_back(violation);
+      violations.back().result = kBadAlignment;
+      violations.back().expected = buffer.alignment;
+    }
+  }
+  // Divide the sweep into shards of arrivals, each of which begins with the
+  // buffers from earlier shards that are still alive.
+  const auto [extents, buffer_idxs] = PrepareSweep(problem, solution);
+  const int num_shards = pool
+      ? std::clamp<size_t>(buffer_idxs.size() / kMinShardBuffers, 1, kMaxShards)
+      : 1;
+  std::vector<std::vector<Violation>> overlaps(num_shards);
+  const auto sweep_shard = [&](int shard) {
+    const size_t begin = buffer_idxs.size() * shard / num_shards;
+    const size_t end = buffer_idxs.size() * (shard + 1) / num_shards;
+    if (begin == end) return;
+    const TimeValue start =
+        problem.buffers[buffer_idxs[begin]].lifespan.lower();
+    std::vector<BufferIdx> actives;
+    for (size_t pos = 0; pos < begin; ++pos) {
+      const BufferIdx buffer_idx = buffer_idxs[pos];
+      if (problem.buffers[buffer_idx].lifespan.upper() > start) {
+        actives.push_back(buffer_idx);
+      }
+    }
+    const std::vector<BufferIdx> arrivals(buffer_idxs.begin() + begin,
+                                          buffer_idxs.begin() + end);
+    AnyCandidatePair(problem, extents, actives, arrivals,
+        [&](BufferIdx i, BufferIdx j) {
+          auto overlap = FindOverlap(problem, solution, i, j);
+          if (overlap) overlaps[shard].push_back(*overlap);
+          return false;  // Keep looking.
+        });
+  };
+  if (pool) {
+    pool->ParallelFor(num_shards, sweep_shard);
+  } else {
+    sweep_shard(0);
+  }
+  const size_t num_violations = violations.size();
+  for (const std::vector<Violation>& shard_overlaps : overlaps) {
+    violations.insert(violations.end(), shard_overlaps.begin(),
+                      shard_overlaps.end());
   }
-  return kGood;
+  std::sort(violations.begin() + num_violations, violations.end(),
+            [](const Violation& a, const Violation& b) {
+              if (a.buffer_idx != b.buffer_idx) {
+                return a.buffer_idx < b.buffer_idx;
+              }
+              return a.other_buffer_idx < b.other_buffer_idx;
+            });
+  return violations;
 }
 
 }  // namespace minimalloc
@@ -17,7 +17,10 @@ limitations under the License.
 #ifndef MINIMALLOC_SRC_VALIDATOR_H_
 #define MINIMALLOC_SRC_VALIDATOR_H_
 
+#include <vector>
+
 #include "minimalloc.h"
+#include "thread_pool.h"
 #include "absl/base/attributes.h"
 
 namespace minimalloc {
@@ -31,9 +34,33 @@ enum ValidationResult {
   kBadAlignment = 5  // At least one buffer was not properly aligned.
 };
 
+// A single violation of a solution.  For overlaps, the lifespan and offsets
+// describe where the pair of buffers collide (i.e., where both are alive and
+// where both may reside); for any other violation, they're those that the
+// buffer occupies.  The expected value is the fixed offset, capacity, or
+// alignment of the buffer (for kBadFixed, kBadOffset, and kBadAlignment).
+struct Violation {
+  ValidationResult result = kGood;
+  BufferIdx buffer_idx = -1;
+  BufferIdx other_buffer_idx = -1;  // Only present for overlaps.
+  Lifespan lifespan;
+  Window offsets;
+  int64_t expected = 0;
+  bool operator==(const Violation& x) const;
+};
+
 ValidationResult Validate(
     const Problem& problem, const Solution& solution) ABSL_MUST_USE_RESULT;
 
+// Collects every violation of a solution, rather than stopping at the first:
+// those of each buffer (in order), followed by all overlapping pairs (ordered
+// by buffer index).  The first violation's result (if any) is the same as that
+// returned by Validate().  Given a thread pool, overlaps are checked
+// concurrently across shards of the timeline.
+std::vector<Violation> ValidateDetailed(const Problem& problem,
+                                        const Solution& solution,
+                                        ThreadPool* pool = nullptr);
+
 }  // namespace minimalloc
 
 #endif  // MINIMALLOC_SRC_VALIDATOR_H_
@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <fstream>
+#include <string>
+
 #include "../src/converter.h"
 
 #include "../src/minimalloc.h"
@@ -372,5 +375,87 @@ TEST(ConverterTest, ExtraFields) {
       absl::StatusCode::kInvalidArgument);
 }
 
+TEST(ConverterTest, FromFileReadsCsv) {
+  const std::string path = ::testing::TempDir() + "/from_file.csv";
+  std::ofstream(path) << "start,size,offset,buffer,upper\n"
+                         "6,18,21,1,12\n5,15,1,0,10\n";
+  EXPECT_THAT(
+      *FromFile(path),
+      (Problem{
+        .buffers = {
+            {.id = "1", .lifespan = {6, 12}, .size = 18, .offset = 21},
+            {.id = "0", .lifespan = {5, 10}, .size = 15, .offset = 1},
+        },
+      }));
+}
+
+TEST(ConverterTest, FromFileEmptyFile) {
+  const std::string path = ::testing::TempDir() + "/from_file_empty.csv";
+  std::ofstream ofs(path);
+  ofs.close();
+  EXPECT_THAT(*FromFile(path), Problem());
+}
+
+TEST(ConverterTest, FromFileMissingFile) {
+  EXPECT_EQ(FromFile(::testing::TempDir() + "/missing.csv").status().code(),
+            absl::StatusCode::kNotFound);
+}
+
+TEST(ConverterTest, BinaryRoundTrip) {
+  const Problem problem = {
+    .buffers = {
+        {.id = "0", .lifespan = {10, 20}, .size = 1, .hint = 3},
+        {.id = "one", .lifespan = {20, 40}, .size = 2, .alignment = 2},
+        {.id = "",
+         .lifespan = {10, 40},
+         .size = 3,
+         .gaps = {{.lifespan = {15, 25}},
+                  {.lifespan = {30, 35}, .window = {{1, 2}}}}},
+    },
+    .capacity = 42,
+  };
+  EXPECT_EQ(*FromBinary(ToBinary(problem)), problem);
+}
+
+TEST(ConverterTest, BinaryWithSolution) {
+  Problem problem = {
+    .buffers = {
+        {.id = "0", .lifespan = {10, 20}, .size = 1},
+        {.id = "1", .lifespan = {20, 40}, .size = 2},
+    },
+  };
+  Solution solution = {.offsets = {0, 4}};
+  absl::StatusOr<Problem> output = FromBinary(ToBinary(problem, &solution));
+  EXPECT_EQ(*output->strip_solution(), solution);
+  EXPECT_EQ(*output, problem);
+}
+
+TEST(ConverterTest, BogusBinary) {
+  const std::string binary = ToBinary(
+      {.buffers = {{.id = "0", .lifespan = {10, 20}, .size = 1}}});
+  EXPECT_TRUE(IsBinary(binary));
+  EXPECT_FALSE(IsBinary("id,lower,upper,size\n"));
+  EXPECT_EQ(FromBinary("id,lower,upper,size\n").status().code(),
+            absl::StatusCode::kInvalidArgument);
+  for (int length = 0; length < binary.size(); ++length) {
+    EXPECT_EQ(FromBinary(binary.substr(0, length)).status().code(),
+              absl::StatusCode::kInvalidArgument);
+  }
+  EXPECT_EQ(FromBinary(binary + "!").status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(ConverterTest, FromFileDetectsFormat) {
+  const Problem problem = {
+    .buffers = {{.id = "0", .lifespan = {10, 20}, .size = 1}},
+  };
+  const std::string csv_path = ::testing::TempDir() + "/from_file.csv";
+  const std::string binary_path = ::testing::TempDir() + "/from_file.bin";
+  std::ofstream(csv_path) << ToCsv(problem);
+  std::ofstream(binary_path, std::ios::binary) << ToBinary(problem);
+  EXPECT_EQ(*FromFile(csv_path), problem);
+  EXPECT_EQ(*FromFile(binary_path), problem);
+}
+
 }  // namespace
 }  // namespace minimalloc
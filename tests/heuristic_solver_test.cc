@@ -0,0 +1,159 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "../src/heuristic_solver.h"
+
+#include <vector>
+
+#include "../src/minimalloc.h"
+#include "../src/solver.h"
+#include "../src/validator.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+
+namespace minimalloc {
+namespace {
+
+// A problem with a few thousand staggered buffers (some of which are aligned,
+// and some of which have gaps).
+Problem getLargeProblem() {
+  Problem problem;
+  for (int i = 0; i < 3000; ++i) {
+    Buffer buffer = {.lifespan = {i, i + (i * 7) % 13 + 2},
+                     .size = (i * 5) % 11 + 1,
+                     .alignment = i % 4 == 0 ? 2 : 1};
+    if (i % 9 == 0) {
+      buffer.gaps = {{.lifespan = {i + 1, i + 2},
+                      .window = Window(0, buffer.size / 2)}};
+    }
+    problem.buffers.push_back(buffer);
+  }
+  problem.capacity = 1 << 20;
+  return problem;
+}
+
+TEST(HeuristicSolverTest, EachGreedyHeuristicIsValid) {
+  for (const GreedyHeuristic& greedy_heuristic :
+      {"size", "conflict", "skyline"}) {
+    Problem problem = getLargeProblem();
+    HeuristicSolver heuristic_solver({.greedy_heuristics = {greedy_heuristic}});
+    const auto solution = heuristic_solver.Solve(problem);
+    ASSERT_TRUE(solution.ok());
+    problem.capacity = problem.peak(*solution);
+    EXPECT_EQ(Validate(problem, *solution), kGood);
+  }
+}
+
+TEST(HeuristicSolverTest, KeepsLowestPeak) {
+  const Problem problem = getLargeProblem();
+  HeuristicSolver heuristic_solver;
+  const auto solution = heuristic_solver.Solve(problem);
+  ASSERT_TRUE(solution.ok());
+  for (const GreedyHeuristic& greedy_heuristic :
+      {"size", "conflict", "skyline"}) {
+    HeuristicSolver other_solver({.greedy_heuristics = {greedy_heuristic}});
+    const auto other_solution = other_solver.Solve(problem);
+    ASSERT_TRUE(other_solution.ok());
+    EXPECT_LE(problem.peak(*solution), problem.peak(*other_solution));
+  }
+}
+
+TEST(HeuristicSolverTest, SweepsWithThreads) {
+  const Problem problem = getLargeProblem();
+  HeuristicSolver heuristic_solver;
+  HeuristicSolver threaded_solver({.sweep_threads = 4});
+  EXPECT_EQ(heuristic_solver.Solve(problem), threaded_solver.Solve(problem));
+}
+
+TEST(HeuristicSolverTest, KeepsBestSolutionWhenNothingFits) {
+  Problem problem = {
+    .buffers = {
+        {.lifespan = {0, 2}, .size = 2},
+        {.lifespan = {1, 3}, .size = 2},
+    },
+    .capacity = 3
+  };
+  HeuristicSolver heuristic_solver;
+  EXPECT_EQ(heuristic_solver.Solve(problem).status().code(),
+            absl::StatusCode::kNotFound);
+  ASSERT_TRUE(heuristic_solver.get_best_solution().has_value());
+  problem.capacity = 4;
+  EXPECT_EQ(Validate(problem, *heuristic_solver.get_best_solution()), kGood);
+}
+
+TEST(HeuristicSolverTest, LnsLowersPeak) {
+  Problem problem = getLargeProblem();
+  HeuristicSolver heuristic_solver;
+  const auto solution = heuristic_solver.Solve(problem);
+  ASSERT_TRUE(solution.ok());
+  HeuristicSolver lns_solver({.lns_timeout = absl::Milliseconds(500)});
+  const auto lns_solution = lns_solver.Solve(problem);
+  ASSERT_TRUE(lns_solution.ok());
+  EXPECT_LT(problem.peak(*lns_solution), problem.peak(*solution));
+  problem.capacity = problem.peak(*lns_solution);
+  EXPECT_EQ(Validate(problem, *lns_solution), kGood);
+}
+
+TEST(HeuristicSolverTest, ImproveHoldsFixedOffsets) {
+  Problem problem = getLargeProblem();
+  HeuristicSolver heuristic_solver({.greedy_heuristics = {"skyline"}});
+  const auto solution = heuristic_solver.Solve(problem);
+  ASSERT_TRUE(solution.ok());
+  for (BufferIdx buffer_idx = 0; buffer_idx < problem.buffers.size();
+      buffer_idx += 10) {
+    problem.buffers[buffer_idx].offset = solution->offsets[buffer_idx];
+  }
+  HeuristicSolver lns_solver({.lns_timeout = absl::Milliseconds(200),
+                              .lns_buffers = 8});
+  const Solution improved = lns_solver.Improve(problem, *solution);
+  EXPECT_LE(problem.peak(improved), problem.peak(*solution));
+  problem.capacity = problem.peak(improved);
+  EXPECT_EQ(Validate(problem, improved), kGood);
+}
+
+TEST(HeuristicSolverTest, ImproveFreesOverlapsThatReachPeak) {
+  // Lowering the peak means moving all three buffers, though each neighborhood
+  // of two that contains the long buffer overlaps the other peak buffer.
+  Problem problem = {
+    .buffers = {
+        {.lifespan = {0, 10}, .size = 1},
+        {.lifespan = {0, 5}, .size = 2},
+        {.lifespan = {5, 10}, .size = 2},
+    },
+    .capacity = 4
+  };
+  const Solution solution = {.offsets = {1, 2, 2}};
+  HeuristicSolver lns_solver({.lns_timeout = absl::Seconds(1),
+                              .lns_buffers = 2});
+  const Solution improved = lns_solver.Improve(problem, solution);
+  EXPECT_EQ(problem.peak(improved), 3);
+  problem.capacity = 3;
+  EXPECT_EQ(Validate(problem, improved), kGood);
+}
+
+TEST(HeuristicSolverTest, RejectsUnknownHeuristic) {
+  const Problem problem = {
+    .buffers = {{.lifespan = {0, 2}, .size = 2}},
+    .capacity = 2
+  };
+  HeuristicSolver heuristic_solver({.greedy_heuristics = {"bogus"}});
+  EXPECT_EQ(heuristic_solver.Solve(problem).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace minimalloc
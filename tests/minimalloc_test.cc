@@ -110,6 +110,27 @@ TEST(BufferTest, EffectiveSizeStairs) {
   EXPECT_EQ(bufferA.effective_size(bufferB), 1);
 }
 
+TEST(BufferTest, EffectiveSizeStairsGapsOutOfOrder) {
+  const Buffer bufferA = {.lifespan = {0, 15},
+                          .size = 3,
+                          .gaps = {{.lifespan = {5, 10}, .window = {{0, 2}}},
+                                   {.lifespan = {0, 5}, .window = {{0, 1}}}}};
+  const Buffer bufferB = {.lifespan = {0, 15},
+                          .size = 3,
+                          .gaps = {{.lifespan = {10, 15}, .window = {{2, 3}}},
+                                   {.lifespan = {5, 10}, .window = {{1, 3}}}}};
+  EXPECT_EQ(bufferA.effective_size(bufferB), 1);
+}
+
+TEST(BufferTest, EffectiveSizeGapsOutsideOverlap) {
+  const Buffer bufferA = {.lifespan = {0, 10},
+                          .size = 4,
+                          .gaps = {{.lifespan = {1, 2}}, {.lifespan = {8, 9}}}};
+  const Buffer bufferB = {.lifespan = {3, 6}, .size = 2};
+  EXPECT_EQ(bufferA.effective_size(bufferB), 4);
+  EXPECT_EQ(bufferB.effective_size(bufferA), 2);
+}
+
 TEST(ProblemTest, StripSolutionOk) {
   Problem problem = {
     .buffers = {
@@ -135,5 +156,18 @@ TEST(ProblemTest, StripSolutionNotFound) {
   EXPECT_EQ(solution.status().code(), absl::StatusCode::kNotFound);
 }
 
+TEST(ProblemTest, Peak) {
+  Problem problem = {
+    .buffers = {
+       {.lifespan = {0, 1}, .size = 2},
+       {.lifespan = {1, 2}, .size = 3},
+       {.lifespan = {0, 2}, .size = 1},
+    },
+    .capacity = 10
+  };
+  EXPECT_EQ(problem.peak({.offsets = {1, 1, 0}}), 4);
+  EXPECT_EQ(problem.peak({.offsets = {4, 0, 3}}), 6);
+}
+
 }  // namespace
 }  // namespace minimalloc
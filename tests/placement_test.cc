@@ -0,0 +1,79 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "../src/placement.h"
+
+#include <vector>
+
+#include "../src/minimalloc.h"
+#include "../src/sweeper.h"
+#include "gtest/gtest.h"
+#include "absl/algorithm/container.h"
+
+namespace minimalloc {
+namespace {
+
+std::vector<PreorderData> getPreordering(const Problem& problem,
+                                         const SweepResult& sweep_result,
+                                         const PreorderingHeuristic& h) {
+  std::vector<PreorderData> preordering =
+      CalcPreordering(problem, sweep_result);
+  absl::c_sort(preordering, PreorderingComparator(h));
+  return preordering;
+}
+
+TEST(PlacementTest, FirstFitFillsHoleBeneathBuffer) {
+  const Problem problem = {
+    .buffers = {
+        {.lifespan = {0, 10}, .size = 5, .offset = 5},
+        {.lifespan = {0, 10}, .size = 4},
+        {.lifespan = {0, 10}, .size = 1, .alignment = 3},
+    },
+    .capacity = 20
+  };
+  const SweepResult sweep_result = Sweep(problem);
+  const std::vector<PreorderData> preordering =
+      getPreordering(problem, sweep_result, "ZWA");
+  const Solution first_fit =
+      PlaceFirstFit(problem, sweep_result, preordering);
+  EXPECT_EQ(first_fit.offsets, std::vector<Offset>({5, 0, 12}));
+  const Solution skyline = PlaceOnSkyline(problem, sweep_result, preordering);
+  EXPECT_EQ(skyline.offsets, std::vector<Offset>({5, 10, 15}));
+}
+
+TEST(PlacementTest, CalcPreorderingFollowsBufferOrder) {
+  const Problem problem = {
+    .buffers = {
+        {.lifespan = {0, 10}, .size = 2},
+        {.lifespan = {5, 15}, .size = 3},
+        {.lifespan = {20, 30}, .size = 4},
+    },
+    .capacity = 20
+  };
+  const std::vector<PreorderData> preordering =
+      CalcPreordering(problem, Sweep(problem));
+  ASSERT_EQ(preordering.size(), 3);
+  for (BufferIdx buffer_idx = 0; buffer_idx < 3; ++buffer_idx) {
+    EXPECT_EQ(preordering[buffer_idx].buffer_idx, buffer_idx);
+    EXPECT_EQ(preordering[buffer_idx].size, problem.buffers[buffer_idx].size);
+  }
+  EXPECT_EQ(preordering[0].total, 5);
+  EXPECT_EQ(preordering[1].total, 5);
+  EXPECT_EQ(preordering[2].total, 4);
+}
+
+}  // namespace
+}  // namespace minimalloc
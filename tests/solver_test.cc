@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "../src/minimalloc.h"
+#include "../src/validator.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/status/status.h"
@@ -41,6 +42,9 @@ TEST(PreorderingComparator, ComparesCorrectly) {
   EXPECT_TRUE(preordering_comparator(data_c, data_a));
   EXPECT_TRUE(preordering_comparator(data_d, data_a));
   EXPECT_TRUE(preordering_comparator(data_a, data_e));
+  data_a.rank = 2;
+  data_e.rank = 1;
+  EXPECT_TRUE(preordering_comparator(data_e, data_a));
 }
 
 SolverParams getDisabledParams() {
@@ -55,6 +59,7 @@ SolverParams getDisabledParams() {
     .monotonic_floor = false,
     .hatless_pruning = false,
     .preordering_heuristics = {"TWA"},
+    .transposition_bytes = 0,
   };
 }
 
@@ -205,6 +210,23 @@ TEST_P(SolverTest, FixedBufferInfeasible) {
   test_infeasible(problem);
 }
 
+TEST(SolverTest, FixedBuffersArePlacedInCanonicalOrder) {
+  // Staggered buffers with fixed offsets leave fragmented space for the rest.
+  Problem problem = {.capacity = 12};
+  for (int i = 0; i < 40; ++i) {
+    problem.buffers.push_back(
+        {.lifespan = {i, i + 3}, .size = 2, .offset = 2 * (i % 5)});
+  }
+  problem.buffers.push_back({.lifespan = {22, 26}, .size = 2});
+  problem.buffers.push_back({.lifespan = {3, 9}, .size = 1});
+  problem.buffers.push_back({.lifespan = {24, 31}, .size = 2});
+  Solver solver;
+  EXPECT_EQ(solver.Solve(problem).status().code(),
+            absl::StatusCode::kNotFound);
+  // No branch places a buffer ahead of one with a lower fixed offset.
+  EXPECT_LT(solver.get_backtracks(), 100);
+}
+
 TEST_P(SolverTest, TwoPartitions) {
   const Problem problem = {
     .buffers = {
@@ -339,6 +361,68 @@ TEST_P(ReducesBacktracksTest, ReducesBacktracks) {
   EXPECT_GT(disabled_solver.get_backtracks(), solver.get_backtracks());
 }
 
+TEST(SolverTest, InfeasibleSectionBeyondFirstBlock) {
+  // Only the section at time 35 is overfull, well past the first few sections.
+  Problem problem = {
+    .buffers = {
+        {.lifespan = {0, 40}, .size = 1},
+        {.lifespan = {35, 36}, .size = 1},
+    },
+    .capacity = 2
+  };
+  for (int idx = 0; idx < 40; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 1}, .size = 1});
+  }
+  for (const bool monotonic_floor : {false, true}) {
+    Solver solver({.monotonic_floor = monotonic_floor});
+    EXPECT_EQ(solver.Solve(problem).status().code(),
+              absl::StatusCode::kNotFound);
+  }
+}
+
+TEST(SolverTest, InfeasibleSectionAmongThousands) {
+  // Enough sections that checks query a section tree rather than scanning.
+  Problem problem = {
+    .buffers = {
+        {.lifespan = {0, 2000}, .size = 1},
+        {.lifespan = {1500, 1501}, .size = 1},
+    },
+    .capacity = 2
+  };
+  for (int idx = 0; idx < 2000; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 1}, .size = 1});
+  }
+  for (const bool monotonic_floor : {false, true}) {
+    Solver solver({.monotonic_floor = monotonic_floor});
+    EXPECT_EQ(solver.Solve(problem).status().code(),
+              absl::StatusCode::kNotFound);
+  }
+}
+
+TEST(SolverTest, InfeasibleSectionInWidePartitionAfterNarrowOnes) {
+  // Only the last partition spans enough sections to query a section tree,
+  // which covers none of the sections before it (and without decomposition,
+  // every check within that partition queries it).
+  Problem problem = {.capacity = 2};
+  for (int idx = 0; idx < 100; ++idx) {
+    problem.buffers.push_back({.lifespan = {2 * idx, 2 * idx + 1}, .size = 2});
+  }
+  problem.buffers.push_back({.lifespan = {200, 2200}, .size = 1});
+  problem.buffers.push_back({.lifespan = {2190, 2191}, .size = 1});
+  for (int idx = 200; idx < 2200; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 1}, .size = 1});
+  }
+  for (const bool monotonic_floor : {false, true}) {
+    Solver solver({.dynamic_decomposition = false,
+                   .monotonic_floor = monotonic_floor});
+    EXPECT_EQ(solver.Solve(problem).status().code(),
+              absl::StatusCode::kNotFound);
+  }
+  problem.capacity = 3;
+  Solver solver({.dynamic_decomposition = false});
+  EXPECT_TRUE(solver.Solve(problem).ok());
+}
+
 TEST(SolverTest, ComputeIrreducibleInfeasibleSubset) {
   const Problem problem = {
     .buffers = {
@@ -356,5 +440,435 @@ TEST(SolverTest, ComputeIrreducibleInfeasibleSubset) {
   EXPECT_THAT(*subset, expected_subset);
 }
 
+TEST(SolverTest, ParallelPortfolioFeasible) {
+  const Problem problem = {
+    .buffers = {
+        {.lifespan = {1, 2}, .size = 1},
+        {.lifespan = {0, 2}, .size = 1},
+        {.lifespan = {2, 3}, .size = 2},
+        {.lifespan = {1, 3}, .size = 1},
+        {.lifespan = {0, 1}, .size = 2},
+    },
+    .capacity = 3
+  };
+  Solver solver({.parallel_portfolio = true});
+  const auto solution = solver.Solve(problem);
+  EXPECT_EQ(solution.status().code(), absl::StatusCode::kOk);
+  EXPECT_EQ(solution->offsets.size(), problem.buffers.size());
+}
+
+TEST(SolverTest, ParallelPortfolioInfeasible) {
+  const Problem problem = {
+    .buffers = {
+        {.lifespan = {0, 1}, .size = 3},
+        {.lifespan = {0, 3}, .size = 1},
+        {.lifespan = {4, 5}, .size = 3},
+        {.lifespan = {2, 5}, .size = 1},
+        {.lifespan = {1, 2}, .size = 2},
+        {.lifespan = {3, 4}, .size = 2},
+        {.lifespan = {1, 4}, .size = 1},
+    },
+    .capacity = 4
+  };
+  Solver solver({.parallel_portfolio = true});
+  const auto solution = solver.Solve(problem);
+  EXPECT_EQ(solution.status().code(), absl::StatusCode::kNotFound);
+  EXPECT_GT(solver.get_backtracks(), 0);
+}
+
+// A problem large enough to be searched in parallel, in which each buffer
+// overlaps with the two buffers that precede it (and the two that follow it).
+Problem getStaggeredProblem(Capacity capacity) {
+  Problem problem = {.capacity = capacity};
+  for (int idx = 0; idx < 24; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 3},
+                               .size = idx % 3 + idx % 5 + 1});
+  }
+  return problem;
+}
+
+// Several copies of the staggered problem laid end to end, optionally joined by
+// a buffer spanning all of them (so that the copies are independent only once
+// it has been placed, i.e., via dynamic decomposition).
+Problem getStaggeredProblems(Capacity capacity, int copies, bool joined) {
+  const Problem staggered_problem = getStaggeredProblem(capacity);
+  Problem problem = {.capacity = capacity};
+  for (int copy = 0; copy < copies; ++copy) {
+    for (Buffer buffer : staggered_problem.buffers) {
+      const TimeValue shift = copy * 30;
+      buffer.lifespan = {buffer.lifespan.lower() + shift,
+                         buffer.lifespan.upper() + shift};
+      problem.buffers.push_back(buffer);
+    }
+  }
+  if (joined) {
+    problem.capacity += 1;
+    problem.buffers.push_back({.lifespan = {0, copies * 30}, .size = 1});
+  }
+  return problem;
+}
+
+TEST(SolverTest, FixedBufferPruningKeepsFeasibleSolutions) {
+  // Like FixedBuffersArePlacedInCanonicalOrder, but with room to spare.
+  Problem problem = {.capacity = 14};
+  for (int i = 0; i < 40; ++i) {
+    problem.buffers.push_back(
+        {.lifespan = {i, i + 3}, .size = 2, .offset = 2 * (i % 5)});
+  }
+  problem.buffers.push_back({.lifespan = {22, 26}, .size = 2});
+  problem.buffers.push_back({.lifespan = {3, 9}, .size = 1});
+  problem.buffers.push_back({.lifespan = {24, 31}, .size = 2});
+  for (const bool dynamic_decomposition : {false, true}) {
+    for (const int search_threads : {1, 4}) {
+      Solver solver({.dynamic_decomposition = dynamic_decomposition,
+                     .search_threads = search_threads});
+      const auto solution = solver.Solve(problem);
+      ASSERT_TRUE(solution.ok());
+      EXPECT_EQ(Validate(problem, *solution), kGood);
+      for (BufferIdx buffer_idx = 0; buffer_idx < 40; ++buffer_idx) {
+        EXPECT_EQ(solution->offsets[buffer_idx],
+                  problem.buffers[buffer_idx].offset);
+      }
+    }
+  }
+}
+
+TEST(SolverTest, ParallelSearchMatchesSequentialSearch) {
+  int num_feasible = 0;
+  for (const Capacity capacity : {14, 15, 16, 17, 18}) {
+    const Problem problem = getStaggeredProblem(capacity);
+    Solver sequential_solver({.preordering_heuristics = {"TWA"}});
+    Solver parallel_solver({.preordering_heuristics = {"TWA"},
+                            .search_threads = 4});
+    const auto expected = sequential_solver.Solve(problem);
+    const auto solution = parallel_solver.Solve(problem);
+    ASSERT_EQ(solution.status().code(), expected.status().code());
+    if (!solution.ok()) continue;
+    ++num_feasible;
+    EXPECT_EQ(Validate(problem, *solution), kGood);
+  }
+  EXPECT_GT(num_feasible, 0);
+}
+
+TEST(SolverTest, ParallelSearchInfeasible) {
+  const Problem problem = getStaggeredProblem(/*capacity=*/14);
+  Solver solver({.preordering_heuristics = {"TWA"}, .search_threads = 4});
+  const auto solution = solver.Solve(problem);
+  EXPECT_EQ(solution.status().code(), absl::StatusCode::kNotFound);
+  EXPECT_GT(solver.get_backtracks(), 0);
+}
+
+TEST(SolverTest, PartitionThreadsMatchSequentialSolve) {
+  int num_feasible = 0;
+  for (const bool joined : {false, true}) {
+    for (const Capacity capacity : {14, 15, 16, 17}) {
+      const Problem problem = getStaggeredProblems(capacity, /*copies=*/3,
+                                                   joined);
+      Solver sequential_solver;
+      Solver concurrent_solver({.partition_threads = 4});
+      const auto expected = sequential_solver.Solve(problem);
+      const auto solution = concurrent_solver.Solve(problem);
+      ASSERT_EQ(solution.status().code(), expected.status().code());
+      if (!solution.ok()) continue;
+      ++num_feasible;
+      EXPECT_EQ(Validate(problem, *solution), kGood);
+    }
+  }
+  EXPECT_GT(num_feasible, 0);
+}
+
+TEST(SolverTest, PartitionThreadsInfeasible) {
+  Problem problem = getStaggeredProblems(/*capacity=*/15, /*copies=*/3,
+                                         /*joined=*/false);
+  problem.buffers.back().size = 16;  // Only the last partition is infeasible.
+  Solver solver({.preordering_heuristics = {"TWA"}, .partition_threads = 4});
+  const auto solution = solver.Solve(problem);
+  EXPECT_EQ(solution.status().code(), absl::StatusCode::kNotFound);
+}
+
+TEST(SolverTest, PartitionThreadsWithSearchThreads) {
+  const Problem problem = getStaggeredProblems(/*capacity=*/16, /*copies=*/3,
+                                               /*joined=*/true);
+  Solver solver({.preordering_heuristics = {"TWA"}, .search_threads = 2,
+                 .partition_threads = 2});
+  const auto solution = solver.Solve(problem);
+  ASSERT_TRUE(solution.ok());
+  EXPECT_EQ(Validate(problem, *solution), kGood);
+}
+
+TEST(SolverTest, HintsReproduceSolutionWithoutBacktracking) {
+  Problem problem = {.capacity = 17};
+  for (int idx = 0; idx < 20; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 4},
+                               .size = idx % 2 + idx % 5 + 1});
+  }
+  Solver solver({.preordering_heuristics = {"TWA"}, .hint_first = true});
+  const auto expected = solver.Solve(problem);
+  ASSERT_TRUE(expected.ok());
+  ASSERT_GT(solver.get_backtracks(), 0);
+  for (BufferIdx buffer_idx = 0; buffer_idx < problem.buffers.size();
+      ++buffer_idx) {
+    problem.buffers[buffer_idx].hint = expected->offsets[buffer_idx];
+  }
+  const auto solution = solver.Solve(problem);
+  ASSERT_TRUE(solution.ok());
+  EXPECT_EQ(*solution, *expected);
+  EXPECT_EQ(solver.get_backtracks(), 0);
+}
+
+TEST(SolverTest, InvalidHintsStillSolve) {
+  Problem problem = getStaggeredProblem(/*capacity=*/15);
+  for (Buffer& buffer : problem.buffers) buffer.hint = 0;
+  Solver solver({.preordering_heuristics = {"TWA"}, .hint_first = true});
+  const auto solution = solver.Solve(problem);
+  ASSERT_TRUE(solution.ok());
+  EXPECT_EQ(Validate(problem, *solution), kGood);
+}
+
+TEST(SolverTest, HintsAreIgnoredByDefault) {
+  Problem problem = getStaggeredProblem(/*capacity=*/15);
+  Solver solver;
+  const auto expected = solver.Solve(problem);
+  ASSERT_TRUE(expected.ok());
+  const int64_t backtracks = solver.get_backtracks();
+  for (Buffer& buffer : problem.buffers) buffer.hint = 0;
+  EXPECT_EQ(solver.Solve(problem), expected);
+  EXPECT_EQ(solver.get_backtracks(), backtracks);
+}
+
+TEST(SolverTest, MinimizeCapacity) {
+  Capacity expected_capacity = 0;
+  for (Capacity capacity = 1; !expected_capacity; ++capacity) {
+    Solver solver;
+    if (solver.Solve(getStaggeredProblem(capacity)).ok()) {
+      expected_capacity = capacity;
+    }
+  }
+  const Problem problem = getStaggeredProblem(/*capacity=*/100);
+  Solver solver;
+  const auto solution = solver.MinimizeCapacity(problem);
+  ASSERT_TRUE(solution.ok());
+  EXPECT_EQ(problem.peak(*solution), expected_capacity);
+  EXPECT_EQ(Validate(problem, *solution), kGood);
+}
+
+TEST(SolverTest, MinimizeCapacityAtLowerBound) {
+  const Problem problem = {
+    .buffers = {
+        {.lifespan = {0, 1}, .size = 2},
+        {.lifespan = {1, 2}, .size = 3},
+        {.lifespan = {1, 2}, .size = 1},
+        {.lifespan = {2, 3}, .size = 2, .offset = 3},
+    },
+    .capacity = 10
+  };
+  Solver solver;
+  const auto solution = solver.MinimizeCapacity(problem);
+  ASSERT_TRUE(solution.ok());
+  EXPECT_EQ(problem.peak(*solution), 5);
+}
+
+TEST(SolverTest, MinimizeCapacityInfeasible) {
+  const Problem problem = getStaggeredProblem(/*capacity=*/14);
+  Solver solver;
+  const auto solution = solver.MinimizeCapacity(problem);
+  EXPECT_EQ(solution.status().code(), absl::StatusCode::kNotFound);
+}
+
+TEST(SolverTest, SolvesLongChain) {
+  // Every buffer overlaps with the next, so each one is placed a level deeper.
+  Problem problem = {.capacity = 2};
+  for (int idx = 0; idx < 2000; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 2}, .size = 1});
+  }
+  for (const bool dynamic_decomposition : {false, true}) {
+    Solver solver({.dynamic_decomposition = dynamic_decomposition,
+                   .preordering_heuristics = {"WAT"}});
+    const auto solution = solver.Solve(problem);
+    ASSERT_TRUE(solution.ok());
+    for (BufferIdx idx = 0; idx + 1 < problem.buffers.size(); ++idx) {
+      EXPECT_NE(solution->offsets[idx], solution->offsets[idx + 1]);
+    }
+  }
+}
+
+TEST(SolverTest, LargePartitionUnderEachPruningSetting) {
+  // A single partition that is large enough to be kept in an order index.
+  Problem problem = {.capacity = 24};
+  for (int idx = 0; idx < 130; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 3},
+                               .size = idx % 5 + idx % 6 + 1});
+  }
+  for (const bool canonical_only : {false, true}) {
+    for (const bool check_dominance : {false, true}) {
+      Solver solver({.canonical_only = canonical_only,
+                     .check_dominance = check_dominance,
+                     .dynamic_decomposition = false,
+                     .preordering_heuristics = {"TWA"}});
+      const auto solution = solver.Solve(problem);
+      ASSERT_TRUE(solution.ok());
+      EXPECT_EQ(Validate(problem, *solution), kGood);
+      EXPECT_GT(solver.get_backtracks(), 0);
+    }
+  }
+}
+
+TEST(SolverTest, TranspositionTableReducesBacktracks) {
+  // Backtracking elsewhere often leaves the same sub-partitions to be solved.
+  Problem problem = {.capacity = 20};
+  for (int idx = 0; idx < 60; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 4},
+                               .size = idx % 5 + idx % 3 + 1});
+  }
+  Solver solver({.preordering_heuristics = {"TWA"},
+                 .transposition_bytes = 64 << 20});
+  const auto solution = solver.Solve(problem);
+  ASSERT_TRUE(solution.ok());
+  EXPECT_EQ(Validate(problem, *solution), kGood);
+
+  Solver disabled_solver({.preordering_heuristics = {"TWA"},
+                          .transposition_bytes = 0});
+  const auto disabled_solution = disabled_solver.Solve(problem);
+  ASSERT_TRUE(disabled_solution.ok());
+  EXPECT_GT(disabled_solver.get_backtracks(), solver.get_backtracks());
+
+  // A budget too small for any entry leaves the search unchanged.
+  Solver tiny_solver({.preordering_heuristics = {"TWA"},
+                      .transposition_bytes = 1});
+  const auto tiny_solution = tiny_solver.Solve(problem);
+  ASSERT_TRUE(tiny_solution.ok());
+  EXPECT_EQ(tiny_solver.get_backtracks(), disabled_solver.get_backtracks());
+}
+
+TEST(SolverTest, TranspositionTableWithPartitionThreads) {
+  Problem problem = {.capacity = 20};
+  for (int idx = 0; idx < 60; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 4},
+                               .size = idx % 5 + idx % 3 + 1});
+  }
+  for (const int search_threads : {1, 4}) {
+    Solver solver({.preordering_heuristics = {"TWA"},
+                   .search_threads = search_threads,
+                   .partition_threads = 4,
+                   .transposition_bytes = 64 << 20});
+    const auto solution = solver.Solve(problem);
+    ASSERT_TRUE(solution.ok());
+    EXPECT_EQ(Validate(problem, *solution), kGood);
+  }
+}
+
+TEST(SolverTest, RandomizedRestartsMatchSequentialSolve) {
+  int num_feasible = 0;
+  for (const bool joined : {false, true}) {
+    for (const Capacity capacity : {14, 15, 16, 17}) {
+      const Problem problem = getStaggeredProblems(capacity, /*copies=*/3,
+                                                   joined);
+      Solver sequential_solver;
+      const auto expected = sequential_solver.Solve(problem);
+      for (const int partition_threads : {1, 4}) {
+        for (const bool luby_restarts : {false, true}) {
+          Solver solver({.partition_threads = partition_threads,
+                         .randomized_restarts = true,
+                         .luby_restarts = luby_restarts});
+          const auto solution = solver.Solve(problem);
+          ASSERT_EQ(solution.status().code(), expected.status().code());
+          if (!solution.ok()) continue;
+          ++num_feasible;
+          EXPECT_EQ(Validate(problem, *solution), kGood);
+        }
+      }
+    }
+  }
+  EXPECT_GT(num_feasible, 0);
+}
+
+TEST(SolverTest, RandomizedRestartsAreReproducible) {
+  // Large enough that the first few node limits are exhausted.
+  Problem problem = {.capacity = 20};
+  for (int idx = 0; idx < 60; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 4},
+                               .size = idx % 5 + idx % 3 + 1});
+  }
+  const SolverParams params = {.preordering_heuristics = {"TWA"},
+                               .transposition_bytes = 0,
+                               .randomized_restarts = true,
+                               .luby_restarts = true,
+                               .seed = 7};
+  Solver solver(params);
+  const auto solution = solver.Solve(problem);
+  ASSERT_TRUE(solution.ok());
+  EXPECT_EQ(Validate(problem, *solution), kGood);
+  Solver same_solver(params);
+  EXPECT_EQ(same_solver.Solve(problem), solution);
+  EXPECT_EQ(same_solver.get_backtracks(), solver.get_backtracks());
+}
+
+TEST(SolverTest, AnytimeSearchesEvenIfGreedySolutionFits) {
+  const Problem problem = getStaggeredProblem(/*capacity=*/30);
+  Solver solver({.anytime = true});
+  const auto solution = solver.Solve(problem);
+  ASSERT_TRUE(solution.ok());
+  EXPECT_EQ(Validate(problem, *solution), kGood);
+  EXPECT_EQ(solution, Solver().Solve(problem));
+  EXPECT_EQ(solver.get_best_solution(), *solution);
+}
+
+TEST(SolverTest, AnytimeKeepsBestSolutionWhenInfeasible) {
+  Problem problem = getStaggeredProblem(/*capacity=*/14);
+  Solver solver({.anytime = true});
+  EXPECT_EQ(solver.Solve(problem).status().code(),
+            absl::StatusCode::kNotFound);
+  ASSERT_TRUE(solver.get_best_solution().has_value());
+  const Solution& solution = *solver.get_best_solution();
+  // The search steps down from the greedy solution to the lowest feasible peak.
+  EXPECT_EQ(problem.peak(solution), 15);
+  problem.capacity = problem.peak(solution);
+  EXPECT_EQ(Validate(problem, solution), kGood);
+}
+
+TEST(SolverTest, AnytimeKeepsBestSolutionOnTimeout) {
+  Problem problem = getStaggeredProblem(/*capacity=*/15);
+  Solver solver({.timeout = absl::ZeroDuration(), .anytime = true});
+  EXPECT_EQ(solver.Solve(problem).status().code(),
+            absl::StatusCode::kDeadlineExceeded);
+  ASSERT_TRUE(solver.get_best_solution().has_value());
+  problem.capacity = problem.peak(*solver.get_best_solution());
+  EXPECT_EQ(Validate(problem, *solver.get_best_solution()), kGood);
+}
+
+TEST(SolverTest, AnytimeMinimizeCapacityImprovesGreedySolution) {
+  const Problem problem = getStaggeredProblem(/*capacity=*/30);
+  Solver solver({.anytime = true});
+  const auto solution = solver.MinimizeCapacity(problem);
+  ASSERT_TRUE(solution.ok());
+  EXPECT_EQ(problem.peak(*solution), 15);
+  EXPECT_EQ(solver.get_best_solution(), *solution);
+}
+
+TEST(SolverTest, NoBestSolutionOutsideOfAnytimeMode) {
+  Solver solver;
+  EXPECT_FALSE(solver.Solve(getStaggeredProblem(/*capacity=*/14)).ok());
+  EXPECT_FALSE(solver.get_best_solution().has_value());
+}
+
+TEST(SolverTest, ParallelPortfolioComputeIrreducibleInfeasibleSubset) {
+  const Problem problem = {
+    .buffers = {
+        {.lifespan = {0, 2}, .size = 2},  // Not part of the IIS.
+        {.lifespan = {0, 2}, .size = 2},  // Not part of the IIS.
+        {.lifespan = {2, 5}, .size = 2},  // Part of the IIS.
+        {.lifespan = {3, 6}, .size = 2},  // Part of the IIS.
+        {.lifespan = {4, 7}, .size = 2},  // Part of the IIS.
+    },
+    .capacity = 4
+  };
+  // Each subproblem is solved by a fresh portfolio, so cancelling the losers of
+  // one portfolio must not leak into the next.
+  Solver solver({.parallel_portfolio = true});
+  auto subset = solver.ComputeIrreducibleInfeasibleSubset(problem);
+  std::vector<minimalloc::BufferIdx> expected_subset = {2, 3, 4};
+  EXPECT_THAT(*subset, expected_subset);
+}
+
 }  // namespace
 }  // namespace minimalloc
@@ -16,14 +16,26 @@ limitations under the License.
 
 #include "../src/sweeper.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "../src/minimalloc.h"
+#include "../src/thread_pool.h"
 #include "gtest/gtest.h"
 
 namespace minimalloc {
 namespace {
 
+TEST(SectionsTest, IndexesEachSection) {
+  const Sections sections = {{0, 2}, {}, {1, 2, 3}};
+  EXPECT_EQ(sections.size(), 3);
+  EXPECT_EQ(std::vector<BufferIdx>(sections[0].begin(), sections[0].end()),
+            std::vector<BufferIdx>({0, 2}));
+  EXPECT_TRUE(sections[1].empty());
+  EXPECT_EQ(std::vector<BufferIdx>(sections[2].begin(), sections[2].end()),
+            std::vector<BufferIdx>({1, 2, 3}));
+}
+
 ////////////// NoOverlap ////////////////
 //                                     //
 //            t=0    t=1    t=2    t=3 //
@@ -175,6 +187,26 @@ TEST(CalculateCutsTest, WithOverlap) {
   EXPECT_EQ(sweep_result.CalculateCuts(), std::vector<CutCount>({0, 1}));
 }
 
+TEST(SweeperTest, LongLivedBufferOverlaps) {
+  // Buffer 0 is alive throughout, and buffer 2 is partially gapped.
+  const Problem problem = {
+      .buffers = {
+          {.lifespan = {0, 3}, .size = 2},
+          {.lifespan = {0, 1}, .size = 1},
+          {.lifespan = {1, 3},
+           .size = 3,
+           .gaps = {{.lifespan = {2, 3}, .window = {{0, 1}}}}},
+      }
+  };
+  const SweepResult sweep_result = Sweep(problem);
+  EXPECT_EQ(sweep_result.buffer_data[0].overlaps,
+            std::vector<Overlap>({{1, 2}, {2, 2}}));
+  EXPECT_EQ(sweep_result.buffer_data[1].overlaps,
+            std::vector<Overlap>({{0, 1}}));
+  EXPECT_EQ(sweep_result.buffer_data[2].overlaps,
+            std::vector<Overlap>({{0, 3}}));
+}
+
 //////// TwoBuffersEndAtSameTime ////////
 //                                     //
 //            t=0    t=1    t=2    t=3 //
@@ -306,7 +338,7 @@ TEST(SweeperTest, SuperLongBufferPreventsPartitioning) {
   EXPECT_EQ(
       Sweep(problem),
       (SweepResult{
-          .sections = {{0, 3}, {1, 3, 2}, {3, 2}},
+          .sections = {{0, 3}, {1, 2, 3}, {2, 3}},
           .partitions = {
               {.buffer_idxs = {0, 3, 1, 2}, .section_range = {0, 3}},
           },
@@ -325,7 +357,7 @@ TEST(SweeperTest, SuperLongBufferPreventsPartitioning) {
 
 TEST(CalculateCutsTest, SuperLongBufferPreventsPartitioning) {
   const SweepResult sweep_result = {
-      .sections = {{0, 3}, {1, 3, 2}, {3, 2}},
+      .sections = {{0, 3}, {1, 2, 3}, {2, 3}},
       .buffer_data = {
           {.section_spans = {{.section_range = {0, 1}, .window = {0, 2}}},
            .overlaps = {{3, 2}}},
@@ -388,7 +420,7 @@ TEST(SweeperTest, BuffersOutOfOrder) {
   EXPECT_EQ(
       Sweep(problem),
       (SweepResult{
-          .sections = {{2}, {1, 0}},
+          .sections = {{2}, {0, 1}},
           .partitions = {
               {.buffer_idxs = {2}, .section_range = {0, 1}},
               {.buffer_idxs = {1, 0}, .section_range = {1, 2}},
@@ -405,7 +437,7 @@ TEST(SweeperTest, BuffersOutOfOrder) {
 
 TEST(CalculateCutsTest, BuffersOutOfOrder) {
   const SweepResult sweep_result = {
-      .sections = {{2}, {1, 0}},
+      .sections = {{2}, {0, 1}},
       .buffer_data = {
           {.section_spans = {{.section_range = {1, 2}, .window = {0, 1}}},
            .overlaps = {{1, 1}}},
@@ -670,5 +702,37 @@ TEST(CalculateCutsTest, MixedGaps) {
   EXPECT_EQ(sweep_result.CalculateCuts(), std::vector<CutCount>({1, 1}));
 }
 
+TEST(CreatePointsTest, ManyBuffersAreSorted) {
+  // Enough points to be radix sorted, including some at negative times.
+  Problem problem = {.capacity = 100};
+  for (int idx = 0; idx < 5000; ++idx) {
+    const int64_t lower = (idx * 7919) % 1000 - 500;
+    Buffer buffer = {.lifespan = {lower, lower + 1 + idx % 7}, .size = 1};
+    if (idx % 4 == 0) buffer.gaps = {{.lifespan = {lower, lower + 1}}};
+    problem.buffers.push_back(buffer);
+  }
+  const std::vector<SweepPoint> points = CreatePoints(problem);
+  std::vector<SweepPoint> sorted_points = points;
+  std::sort(sorted_points.begin(), sorted_points.end());
+  EXPECT_EQ(points, sorted_points);
+}
+
+TEST(SweeperTest, ThreadPoolGivesSameResult) {
+  // Many small partitions of (possibly gapped) buffers, listed out of order.
+  Problem problem = {.capacity = 100};
+  for (int idx = 0; idx < 20000; ++idx) {
+    const int64_t partition = (idx * 7919) % 5000;
+    const int64_t lower = partition * 10 + idx % 4;
+    Buffer buffer = {.lifespan = {lower, lower + 3 + idx % 5}, .size = 1};
+    if (idx % 3 == 0) {
+      buffer.gaps = {{.lifespan = {lower + 1, lower + 2}, .window = {{0, 1}}}};
+    }
+    problem.buffers.push_back(buffer);
+  }
+  ThreadPool thread_pool(3);
+  EXPECT_EQ(CreatePoints(problem, &thread_pool), CreatePoints(problem));
+  EXPECT_EQ(Sweep(problem, &thread_pool), Sweep(problem));
+}
+
 }  // namespace
 }  // namespace minimalloc
@@ -0,0 +1,64 @@
+/*
+Copyright 2023 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "../src/thread_pool.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace minimalloc {
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryIndexOnce) {
+  ThreadPool pool(/*num_threads=*/3);
+  std::vector<std::atomic<int>> counts(100);
+  pool.ParallelFor(counts.size(), [&](int idx) { ++counts[idx]; });
+  for (const std::atomic<int>& count : counts) EXPECT_EQ(count, 1);
+}
+
+TEST(ThreadPoolTest, CallerRunsFirstIndex) {
+  ThreadPool pool(/*num_threads=*/3);
+  const std::thread::id caller_id = std::this_thread::get_id();
+  std::thread::id first_id;
+  pool.ParallelFor(10, [&](int idx) {
+    if (idx == 0) first_id = std::this_thread::get_id();
+  });
+  EXPECT_EQ(first_id, caller_id);
+}
+
+TEST(ThreadPoolTest, WithoutBackgroundThreads) {
+  ThreadPool pool(/*num_threads=*/0);
+  int sum = 0;
+  pool.ParallelFor(10, [&](int idx) { sum += idx; });
+  EXPECT_EQ(sum, 45);
+}
+
+TEST(ThreadPoolTest, NestedBatches) {
+  ThreadPool pool(/*num_threads=*/2);
+  std::atomic<int> count = 0;
+  pool.ParallelFor(8, [&](int) {
+    pool.ParallelFor(8, [&](int) {
+      pool.ParallelFor(8, [&](int) { ++count; });
+    });
+  });
+  EXPECT_EQ(count, 512);
+}
+
+}  // namespace
+}  // namespace minimalloc
@@ -16,7 +16,10 @@ limitations under the License.
 
 #include "../src/validator.h"
 
+#include <vector>
+
 #include "../src/minimalloc.h"
+#include "../src/thread_pool.h"
 #include "gtest/gtest.h"
 
 namespace minimalloc {
@@ -206,5 +209,101 @@ TEST(ValidatorTest, InvalidatesGapOverlap) {
   EXPECT_EQ(Validate(problem, solution), kBadOverlap);
 }
 
+TEST(ValidatorTest, InvalidatesOverlapWithLongLivedBuffer) {
+  const Problem problem = {
+      .buffers = {
+           {.lifespan = {0, 10}, .size = 1},
+           {.lifespan = {1, 3}, .size = 1},
+           {.lifespan = {3, 5}, .size = 1},
+           {.lifespan = {5, 7}, .size = 1},
+           {.lifespan = {8, 9}, .size = 1},
+      },
+      .capacity = 2
+  };
+  // first and last buffers overlap, despite many buffers in between
+  const Solution solution = {.offsets = {0, 1, 1, 1, 0}};
+  EXPECT_EQ(Validate(problem, solution), kBadOverlap);
+}
+
+TEST(ValidatorTest, DetailsEveryViolation) {
+  const Problem problem = {
+      .buffers = {
+           {.lifespan = {0, 4}, .size = 2},
+           {.lifespan = {1, 3}, .size = 2},
+           {.lifespan = {2, 6}, .size = 1, .alignment = 2},
+           {.lifespan = {5, 6}, .size = 1, .offset = 0},
+      },
+      .capacity = 3
+  };
+  // the first three buffers overlap, and the last two are out of place
+  const Solution solution = {.offsets = {0, 1, 1, 2}};
+  EXPECT_EQ(ValidateDetailed(problem, solution),
+            std::vector<Violation>({
+                {.result = kBadAlignment,
+                 .buffer_idx = 2,
+                 .lifespan = {2, 6},
+                 .offsets = {1, 2},
+                 .expected = 2},
+                {.result = kBadFixed,
+                 .buffer_idx = 3,
+                 .lifespan = {5, 6},
+                 .offsets = {2, 3},
+                 .expected = 0},
+                {.result = kBadOverlap,
+                 .buffer_idx = 0,
+                 .other_buffer_idx = 1,
+                 .lifespan = {1, 3},
+                 .offsets = {1, 2}},
+                {.result = kBadOverlap,
+                 .buffer_idx = 0,
+                 .other_buffer_idx = 2,
+                 .lifespan = {2, 4},
+                 .offsets = {1, 2}},
+                {.result = kBadOverlap,
+                 .buffer_idx = 1,
+                 .other_buffer_idx = 2,
+                 .lifespan = {2, 3},
+                 .offsets = {1, 2}},
+            }));
+  EXPECT_EQ(Validate(problem, solution), kBadAlignment);
+}
+
+TEST(ValidatorTest, DetailsGoodSolution) {
+  const Problem problem = {
+      .buffers = {
+           {.lifespan = {0, 1}, .size = 2},
+           {.lifespan = {1, 2}, .size = 1},
+           {.lifespan = {1, 2}, .size = 1},
+      },
+      .capacity = 2
+  };
+  const Solution solution = {.offsets = {0, 0, 1}};
+  EXPECT_TRUE(ValidateDetailed(problem, solution).empty());
+}
+
+TEST(ValidatorTest, DetailsBadSolution) {
+  const Problem problem = {
+      .buffers = {{.lifespan = {0, 1}, .size = 2}},
+      .capacity = 2
+  };
+  const Solution solution = {.offsets = {0, 0}};
+  EXPECT_EQ(ValidateDetailed(problem, solution),
+            std::vector<Violation>({{.result = kBadSolution}}));
+}
+
+TEST(ValidatorTest, ThreadPoolDetailsSameViolations) {
+  // Buffers that are staggered over time, with every hundredth one misplaced.
+  Problem problem = {.capacity = 40};
+  Solution solution;
+  for (int idx = 0; idx < 20000; ++idx) {
+    problem.buffers.push_back({.lifespan = {idx, idx + 10}, .size = 4});
+    solution.offsets.push_back((idx % 10 + (idx % 100 == 0)) % 10 * 4);
+  }
+  ThreadPool thread_pool(3);
+  const std::vector<Violation> violations = ValidateDetailed(problem, solution);
+  EXPECT_EQ(violations.size(), 2 * 200 - 1);
+  EXPECT_EQ(ValidateDetailed(problem, solution, &thread_pool), violations);
+}
+
 }  // namespace
 }  // namespace minimalloc